@@ -0,0 +1,166 @@
+#include "CompileCost.hpp"
+#include "PeakRss.hpp"
+#include "SyntheticSvd.hpp"
+
+#include "DeviceModel.hpp"
+#include "FileBuilder.hpp"
+#include "Generator.hpp"
+#include "StreamParser.hpp"
+#include "XmlParser.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// The large devices take seconds per run, use --benchmark-samples to keep
+// the total time bounded
+const std::vector< bench::SvdShape > shapes = {
+    { 20, 10, 4, 0.25 },
+    { 200, 30, 8, 0.25 },
+    { 1000, 40, 8, 0.5 },
+};
+
+// Same option names as main(), only the ones the benchmarks pass
+cxxopts::ParseResult parseOptions( std::vector< const char* > args )
+{
+    static cxxopts::Options options( "svd2cpp_bench" );
+    static const bool declared = [] {
+        options.add_options()( "p, parser", "", cxxopts::value< std::string >() )( "dedup", "" )( "no-runtime", "" )(
+            "overlay", "" )( "lean", "" );
+        return true;
+    }();
+    (void)declared;
+    args.insert( args.begin(), "svd2cpp_bench" );
+    return options.parse( static_cast< int >( args.size() ), args.data() );
+}
+
+DeviceModel parseModel( const std::filesystem::path& svd )
+{
+    XmlParser parser( svd.string() );
+    parser.parseXml();
+    REQUIRE( !parser.isError() );
+    return DeviceModel::fromPeripherals( parser.getDeviceInfo(), parser.getPeripherals() );
+}
+
+// Firmware TU touching registers of two peripherals of a synthetic device,
+// including the header is what most of its compile time goes to
+const char* const probe = R"(#include "probe.hpp"
+using P0 = FEmbed::Periph0<>;
+using P1 = FEmbed::Periph1<>;
+unsigned int probe( unsigned int value )
+{
+    FEmbed::set<P0::Reg0::F0>();
+    FEmbed::write<P0::Reg1::F1, P0::Reg1::F2>( value, 1 );
+    FEmbed::init<P1::Reg2::F1>( value );
+    return FEmbed::read<P1::Reg3::F0>();
+}
+)";
+
+} // namespace
+
+TEST_CASE( "XmlParser::parseXml", "[parse]" )
+{
+    for( auto& shape : shapes ) {
+        const auto svd = bench::writeSyntheticSvd( shape );
+        BENCHMARK_ADVANCED( "dom " + shape.label() )( Catch::Benchmark::Chronometer meter )
+        {
+            //Loading the document is part of the constructor, only parsing is timed
+            std::vector< std::unique_ptr< XmlParser > > parsers( static_cast< std::size_t >( meter.runs() ) );
+            for( auto& parser : parsers ) {
+                parser = std::make_unique< XmlParser >( svd.string() );
+            }
+            meter.measure( [&]( int run ) { parsers[static_cast< std::size_t >( run )]->parseXml(); } );
+        };
+        BENCHMARK_ADVANCED( "stream " + shape.label() )( Catch::Benchmark::Chronometer meter )
+        {
+            std::vector< std::unique_ptr< StreamParser > > parsers( static_cast< std::size_t >( meter.runs() ) );
+            for( auto& parser : parsers ) {
+                parser = std::make_unique< StreamParser >( svd.string() );
+            }
+            meter.measure( [&]( int run ) { parsers[static_cast< std::size_t >( run )]->parseXml(); } );
+        };
+    }
+}
+
+TEST_CASE( "FileBuilder::build", "[emit]" )
+{
+    const auto options = parseOptions( {} );
+    for( auto& shape : shapes ) {
+        const DeviceModel model = parseModel( bench::writeSyntheticSvd( shape ) );
+        BENCHMARK( "emit " + shape.label() )
+        {
+            FileBuilder builder( options, model );
+            builder.setupBuilders();
+            builder.build();
+            return builder.takeOutput().size();
+        };
+    }
+}
+
+TEST_CASE( "End to end", "[e2e]" )
+{
+    const auto dom = parseOptions( { "--no-runtime" } );
+    const auto stream = parseOptions( { "--parser", "stream", "--no-runtime" } );
+    const auto dedup = parseOptions( { "--dedup", "--no-runtime" } );
+    std::string memory;
+    for( auto& shape : shapes ) {
+        const auto svd = bench::writeSyntheticSvd( shape );
+        const auto header = std::filesystem::path( svd ).replace_extension( ".hpp" );
+        for( auto [name, options] : { std::pair{ "dom", &dom }, std::pair{ "stream", &stream },
+                 std::pair{ "dom --dedup", &dedup } } ) {
+            const Generator generator( *options );
+            const auto rss = bench::measureRss( [&] { generator.run( svd.string(), header.string() ); } );
+            memory += fmt::format( "{} {}: peak RSS {} KiB, {} KiB at start\n", name, shape.label(), rss.peakKiB,
+                rss.startKiB );
+            BENCHMARK( fmt::format( "{} {}", name, shape.label() ) )
+            {
+                return generator.run( svd.string(), header.string() ).ok();
+            };
+        }
+        std::filesystem::remove( header );
+    }
+    fmt::print( "\n{}", memory );
+}
+
+TEST_CASE( "Compiling the header", "[compile]" )
+{
+    //The frontend cost every TU including the header pays, per emission profile
+    const std::vector< std::pair< const char*, std::vector< const char* > > > profiles = {
+        { "default", {} },
+        { "--dedup", { "--dedup" } },
+        { "--overlay", { "--overlay" } },
+        { "--lean", { "--lean" } },
+        { "--lean --dedup", { "--lean", "--dedup" } },
+    };
+    std::string report;
+    //The largest header takes minutes per compile
+    for( auto& shape : { shapes[0], shapes[1] } ) {
+        const auto svd = bench::writeSyntheticSvd( shape );
+        const auto directory = std::filesystem::path( svd ).replace_extension();
+        std::filesystem::create_directories( directory );
+        const auto source = directory / "probe.cpp";
+        std::ofstream( source ) << probe;
+        for( auto& [name, args] : profiles ) {
+            const auto options = parseOptions( args );
+            REQUIRE( Generator( options ).run( svd.string(), ( directory / "probe.hpp" ).string() ).ok() );
+            const auto cost = bench::compileCost( source );
+            REQUIRE( cost.ok );
+            report += fmt::format( "{} {}: {} header bytes, {:.0f} ms, peak RSS {} KiB\n  {}\n", name, shape.label(),
+                std::filesystem::file_size( directory / "probe.hpp" ), cost.ms, cost.peakKiB, cost.timeReport );
+            BENCHMARK( fmt::format( "{} {}", name, shape.label() ) )
+            {
+                return bench::compileCost( source ).ok;
+            };
+        }
+        std::filesystem::remove_all( directory );
+    }
+    fmt::print( "\n{}", report );
+}
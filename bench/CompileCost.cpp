@@ -0,0 +1,78 @@
+#include "CompileCost.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+namespace {
+
+std::vector< std::string > compilerCommand( const std::filesystem::path& source, const std::vector< std::string >& flags )
+{
+    std::vector< std::string > command = { SVD2CPP_BENCH_CXX, "-std=c++17", "-fsyntax-only", "-ftime-report" };
+    command.push_back( "-I" + source.parent_path().string() );
+    command.insert( command.end(), flags.begin(), flags.end() );
+    command.push_back( source.string() );
+    return command;
+}
+
+std::string totalLine( const std::filesystem::path& report )
+{
+    std::ifstream file( report );
+    std::string line;
+    while( std::getline( file, line ) ) {
+        if( line.find( "TOTAL" ) != std::string::npos ) {
+            return line;
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+CompileCost compileCost( const std::filesystem::path& source, const std::vector< std::string >& flags )
+{
+    const std::vector< std::string > command = compilerCommand( source, flags );
+    const std::filesystem::path report = std::filesystem::path( source ).replace_extension( ".time" );
+    CompileCost cost;
+    const auto start = std::chrono::steady_clock::now();
+#ifdef __linux__
+    //wait4 reports the peak RSS of this child alone
+    const pid_t child = fork();
+    if( child == 0 ) {
+        const int fd = open( report.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        dup2( fd, STDERR_FILENO );
+        std::vector< char* > args;
+        for( auto& arg : command ) {
+            args.push_back( const_cast< char* >( arg.c_str() ) );
+        }
+        args.push_back( nullptr );
+        execvp( args[0], args.data() );
+        _exit( 127 );
+    }
+    int status = 0;
+    rusage usage{};
+    cost.ok = child > 0 && wait4( child, &status, 0, &usage ) == child && WIFEXITED( status )
+        && WEXITSTATUS( status ) == 0;
+    cost.peakKiB = static_cast< std::size_t >( usage.ru_maxrss );
+#else
+    std::string line;
+    for( auto& arg : command ) {
+        line += "\"" + arg + "\" ";
+    }
+    cost.ok = std::system( ( line + "2>\"" + report.string() + "\"" ).c_str() ) == 0;
+#endif
+    cost.ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+    cost.timeReport = totalLine( report );
+    return cost;
+}
+
+} // namespace bench
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct CompileCost
+{
+    bool ok = false;
+    double ms = 0;
+    // Peak RSS of the compiler process, 0 where it isn't reported
+    std::size_t peakKiB = 0;
+    // "TOTAL" line of -ftime-report, empty if the compiler didn't print one
+    std::string timeReport;
+};
+
+// Runs the compiler svd2cpp_bench was built with as a frontend only
+// (-fsyntax-only -ftime-report) on source, with the source's directory as
+// include path. The report goes to source with the extension ".time".
+CompileCost compileCost( const std::filesystem::path& source, const std::vector< std::string >& flags = {} );
+
+} // namespace bench
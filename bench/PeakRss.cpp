@@ -0,0 +1,52 @@
+#include "PeakRss.hpp"
+
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+namespace bench {
+
+namespace {
+
+// "VmRSS:" or "VmHWM:" of /proc/self/status in KiB, 0 if unavailable
+std::size_t statusKiB( const std::string& key )
+{
+    std::ifstream status( "/proc/self/status" );
+    std::string line;
+    while( std::getline( status, line ) ) {
+        if( line.compare( 0, key.size(), key ) == 0 ) {
+            return std::stoul( line.substr( key.size() ) );
+        }
+    }
+    return 0;
+}
+
+std::size_t maxRssKiB()
+{
+#ifdef __linux__
+    rusage usage{};
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+        return static_cast< std::size_t >( usage.ru_maxrss );
+    }
+#endif
+    return 0;
+}
+
+} // namespace
+
+RssUsage measureRss( const std::function< void() >& work )
+{
+    RssUsage usage;
+    //"5" resets VmHWM to the current RSS
+    std::ofstream clearRefs( "/proc/self/clear_refs" );
+    const bool reset = clearRefs && ( clearRefs << "5" ).flush();
+    usage.startKiB = statusKiB( "VmRSS:" );
+    work();
+    usage.peakKiB = reset ? statusKiB( "VmHWM:" ) : maxRssKiB();
+    return usage;
+}
+
+} // namespace bench
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace bench {
+
+struct RssUsage
+{
+    // Resident set size when work started, KiB
+    std::size_t startKiB = 0;
+    // Highest resident set size while it ran, KiB
+    std::size_t peakKiB = 0;
+};
+
+// Runs work and reports the peak RSS it reached. On Linux the high-water
+// mark is reset before (/proc/self/clear_refs), elsewhere, or when that
+// isn't permitted, peakKiB is the peak of the whole process so far.
+RssUsage measureRss( const std::function< void() >& work );
+
+} // namespace bench
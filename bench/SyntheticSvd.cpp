@@ -0,0 +1,109 @@
+#include "SyntheticSvd.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace bench {
+
+std::string SvdShape::label() const
+{
+    return fmt::format( "{}x{}x{} {:.0f}% derived", peripherals, registers, fields, derived * 100 );
+}
+
+std::string syntheticSvd( const SvdShape& shape )
+{
+    std::string svd;
+    auto it = std::back_inserter( svd );
+    fmt::format_to( it,
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<device schemaVersion=\"1.3\">\n"
+        "  <name>SYNTH</name>\n"
+        "  <version>1.0</version>\n"
+        "  <size>32</size>\n"
+        "  <resetValue>0x0</resetValue>\n"
+        "  <peripherals>\n" );
+    //Every 1/derived-th peripheral derives from the last one with registers
+    double derivedSoFar = 0;
+    unsigned int base = 0;
+    for( unsigned int p = 0; p < shape.peripherals; ++p ) {
+        const std::uint32_t address = 0x40000000 + p * 0x400;
+        derivedSoFar += shape.derived;
+        if( p > 0 && derivedSoFar >= 1 ) {
+            derivedSoFar -= 1;
+            fmt::format_to( it,
+                "    <peripheral derivedFrom=\"PERIPH{}\">\n"
+                "      <name>PERIPH{}</name>\n"
+                "      <baseAddress>0x{:08X}</baseAddress>\n"
+                "    </peripheral>\n",
+                base, p, address );
+            continue;
+        }
+        base = p;
+        fmt::format_to( it,
+            "    <peripheral>\n"
+            "      <name>PERIPH{0}</name>\n"
+            "      <description>Synthetic peripheral {0}</description>\n"
+            "      <groupName>GROUP{1}</groupName>\n"
+            "      <baseAddress>0x{2:08X}</baseAddress>\n"
+            "      <addressBlock>\n"
+            "        <offset>0x0</offset>\n"
+            "        <size>0x400</size>\n"
+            "        <usage>registers</usage>\n"
+            "      </addressBlock>\n"
+            "      <registers>\n",
+            p, p % 16, address );
+        for( unsigned int r = 0; r < shape.registers; ++r ) {
+            fmt::format_to( it,
+                "        <register>\n"
+                "          <name>REG{0}</name>\n"
+                "          <description>Register {0} of peripheral {1}</description>\n"
+                "          <addressOffset>0x{2:X}</addressOffset>\n"
+                "          <access>{3}</access>\n"
+                "          <resetValue>0x{4:08X}</resetValue>\n"
+                "          <fields>\n",
+                r, p, r * 4, r % 5 == 4 ? "read-only" : "read-write", ( p * 2654435761u + r * 40503u ) );
+            //Widths 1..4 bits, fields wrap around inside the 32 bits
+            unsigned int offset = 0;
+            for( unsigned int f = 0; f < shape.fields; ++f ) {
+                const unsigned int width = 1 + ( p + r + f ) % 4;
+                if( offset + width > 32 ) {
+                    offset = 0;
+                }
+                fmt::format_to( it,
+                    "            <field>\n"
+                    "              <name>F{0}</name>\n"
+                    "              <description>Field {0}</description>\n"
+                    "              <bitOffset>{1}</bitOffset>\n"
+                    "              <bitWidth>{2}</bitWidth>\n"
+                    "            </field>\n",
+                    f, offset, width );
+                offset += width;
+            }
+            svd += "          </fields>\n"
+                   "        </register>\n";
+        }
+        svd += "      </registers>\n"
+               "    </peripheral>\n";
+    }
+    svd += "  </peripherals>\n"
+           "</device>\n";
+    return svd;
+}
+
+std::filesystem::path writeSyntheticSvd( const SvdShape& shape )
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path()
+        / fmt::format( "svd2cpp_bench_{}x{}x{}_{}.svd", shape.peripherals, shape.registers, shape.fields,
+            static_cast< unsigned int >( shape.derived * 100 ) );
+    const std::string svd = syntheticSvd( shape );
+    std::ofstream file( path, std::ios::binary );
+    file.write( svd.data(), static_cast< std::streamsize >( svd.size() ) );
+    if( !file ) {
+        throw std::runtime_error( "Failed to write " + path.string() );
+    }
+    return path;
+}
+
+} // namespace bench
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// Deterministic synthetic devices for the benchmarks, the same shape always
+// produces the same document so timings of different releases compare.
+namespace bench {
+
+struct SvdShape
+{
+    unsigned int peripherals = 100;
+    // Per peripheral that isn't derived
+    unsigned int registers = 20;
+    // Per register
+    unsigned int fields = 8;
+    // Share of peripherals declared with derivedFrom and no registers of
+    // their own, 0 to 1
+    double derived = 0.25;
+
+    std::string label() const;
+};
+
+std::string syntheticSvd( const SvdShape& shape );
+
+// Writes the document into the temp directory, named after the shape
+std::filesystem::path writeSyntheticSvd( const SvdShape& shape );
+
+} // namespace bench
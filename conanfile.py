@@ -8,7 +8,7 @@ from conan.tools.cmake import CMake, CMakeToolchain
 
 class Project(ConanFile):
     settings = "os", "compiler", "build_type", "arch"
-    requires = ["catch2/3.4.0", "spdlog/1.12.0", "tinyxml2/9.0.0", "cxxopts/3.1.1"]
+    requires = ["catch2/3.4.0", "spdlog/1.12.0", "tinyxml2/9.0.0", "cxxopts/3.1.1", "zlib/1.3", "xz_utils/5.4.5"]
     generators = "CMakeDeps"
 
     def generate(self) -> None:
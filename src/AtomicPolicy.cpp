@@ -0,0 +1,71 @@
+#include "AtomicPolicy.hpp"
+#include "Glob.hpp"
+#include "SvdValues.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace {
+
+const std::string bitBand = "BitBand";
+
+bool inBitBandRegion( std::uint32_t address )
+{
+    return ( address >= 0x20000000 && address < 0x20100000 ) || ( address >= 0x40000000 && address < 0x40100000 );
+}
+
+std::string runtimePolicy( std::string_view policy )
+{
+    if( policy == "none" ) {
+        return {};
+    }
+    if( policy == "bitband" ) {
+        return bitBand;
+    }
+    if( policy.substr( 0, 6 ) == "alias:" ) {
+        std::uint64_t offsets[3] = {};
+        std::string_view list = policy.substr( 6 );
+        for( auto& offset : offsets ) {
+            const auto colon = std::min( list.find( ':' ), list.size() );
+            if( colon != 0 && !svd::parseScaledInteger( list.substr( 0, colon ), offset ) ) {
+                throw std::invalid_argument( "Invalid alias offset in --atomic " + std::string( policy ) );
+            }
+            list.remove_prefix( std::min( colon + 1, list.size() ) );
+        }
+        return fmt::format( "AliasOffsets<0x{:x}, 0x{:x}, 0x{:x}>", offsets[0], offsets[1], offsets[2] );
+    }
+    throw std::invalid_argument( "Unknown --atomic policy " + std::string( policy ) );
+}
+
+} // namespace
+
+AtomicPolicies::AtomicPolicies( const std::vector< std::string >& rules_ )
+{
+    for( std::string_view rule : rules_ ) {
+        const auto equals = rule.find( '=' );
+        if( equals == std::string_view::npos ) {
+            rules.push_back( { {}, runtimePolicy( rule ) } );
+        }
+        else {
+            rules.push_back( { std::string( rule.substr( 0, equals ) ), runtimePolicy( rule.substr( equals + 1 ) ) } );
+        }
+    }
+}
+
+std::string AtomicPolicies::policyOf( const DeviceModel& model, const PeripheralRecord& peripheral ) const
+{
+    //Read-modify-write unless a rule says otherwise, even on cores with
+    //bit-band: not every part of them implements the alias regions
+    std::string policy;
+    for( auto& rule : rules ) {
+        if( rule.pattern.empty() || globMatch( rule.pattern, model.str( peripheral.name ) )
+            || globMatch( rule.pattern, model.str( peripheral.groupName ) ) ) {
+            policy = rule.policy;
+        }
+    }
+    if( policy == bitBand && !inBitBandRegion( peripheral.baseAddress ) ) {
+        return {};
+    }
+    return policy;
+}
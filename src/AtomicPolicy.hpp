@@ -0,0 +1,34 @@
+#pragma once
+
+#include "DeviceModel.hpp"
+
+#include <string>
+#include <vector>
+
+// Which runtime Atomic policy the registers of a peripheral get, so set,
+// reset and toggle can be a single store instead of a read-modify-write.
+// --atomic rules are "[PATTERN=]POLICY", PATTERN is a peripheral name or glob
+// matched against the name or groupName like --only, POLICY is one of
+//   none                     read-modify-write
+//   bitband                  Cortex-M3/M4 bit-band alias
+//   alias:SET:CLEAR:TOGGLE   vendor alias register offsets, 0 if missing
+// A rule without pattern sets the device's policy, later rules win. Without
+// rules every peripheral is read-modify-write.
+struct AtomicPolicies
+{
+    AtomicPolicies() = default;
+    // Throws std::invalid_argument for a malformed rule
+    explicit AtomicPolicies( const std::vector< std::string >& rules_ );
+    // Runtime type of the peripheral's policy, empty for read-modify-write.
+    // Bit-band is only used for peripherals in the bit-band region.
+    std::string policyOf( const DeviceModel& model, const PeripheralRecord& peripheral ) const;
+
+private:
+    struct Rule
+    {
+        std::string pattern;
+        // Runtime type, empty for none
+        std::string policy;
+    };
+    std::vector< Rule > rules;
+};
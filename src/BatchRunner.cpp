@@ -0,0 +1,180 @@
+#include "BatchRunner.hpp"
+#include "Glob.hpp"
+#include "InputFile.hpp"
+#include "Runtime.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string trim( const std::string& str )
+{
+    const auto begin = str.find_first_not_of( " \t\r\n" );
+    if( begin == std::string::npos ) {
+        return {};
+    }
+    const auto end = str.find_last_not_of( " \t\r\n" );
+    return str.substr( begin, end - begin + 1 );
+}
+
+} // namespace
+
+BatchRunner::BatchRunner( const cxxopts::ParseResult& options_,
+    const std::vector< std::string >& inputSpecs,
+    const fs::path& outputDir_ )
+    : options( options_ )
+    , outputDir( outputDir_ )
+{
+    std::vector< fs::path > inputs;
+    for( auto& spec : inputSpecs ) {
+        collectInputs( spec, inputs );
+    }
+    assignOutputs( inputs );
+}
+
+void BatchRunner::collectInputs( const std::string& spec, std::vector< fs::path >& inputs )
+{
+    std::error_code ec;
+    if( !spec.empty() && spec.front() == '@' ) {
+        //Manifest: one input spec per line, relative to the manifest, '#' starts a comment
+        const fs::path manifest = spec.substr( 1 );
+        std::ifstream file( manifest );
+        if( !file ) {
+            specErrors.push_back( "Couldn't open manifest " + manifest.string() );
+            return;
+        }
+        for( std::string line; std::getline( file, line ); ) {
+            line = trim( line.substr( 0, line.find( '#' ) ) );
+            if( line.empty() ) {
+                continue;
+            }
+            const fs::path entry = line;
+            collectInputs( entry.is_absolute() ? line : ( manifest.parent_path() / entry ).string(), inputs );
+        }
+        return;
+    }
+    if( hasGlobChars( spec ) ) {
+        //Only the file name part may contain wildcards
+        const fs::path pattern = spec;
+        const fs::path dir = pattern.has_parent_path() ? pattern.parent_path() : fs::path( "." );
+        const std::string namePattern = pattern.filename().string();
+        std::vector< fs::path > matches;
+        for( auto& entry : fs::directory_iterator( dir, ec ) ) {
+            if( entry.is_regular_file() && globMatch( namePattern, entry.path().filename().string() ) ) {
+                matches.push_back( entry.path() );
+            }
+        }
+        if( ec || matches.empty() ) {
+            specErrors.push_back( "No input matches " + spec );
+        }
+        std::sort( matches.begin(), matches.end() );
+        inputs.insert( inputs.end(), matches.begin(), matches.end() );
+        return;
+    }
+    if( fs::is_directory( spec, ec ) ) {
+        std::vector< fs::path > matches;
+        for( auto& entry : fs::recursive_directory_iterator( spec, ec ) ) {
+            if( entry.is_regular_file() && input::isSvdFile( entry.path() ) ) {
+                matches.push_back( entry.path() );
+            }
+        }
+        std::sort( matches.begin(), matches.end() );
+        inputs.insert( inputs.end(), matches.begin(), matches.end() );
+        return;
+    }
+    if( !fs::exists( input::fileOf( spec ), ec ) ) {
+        specErrors.push_back( "Input " + spec + " doesn't exist" );
+        return;
+    }
+    inputs.push_back( spec );
+}
+
+void BatchRunner::assignOutputs( const std::vector< fs::path >& inputs )
+{
+    std::error_code ec;
+    std::set< fs::path > seenInputs;
+    std::map< fs::path, fs::path > outputOwners;
+    for( auto& input : inputs ) {
+        if( !seenInputs.insert( fs::weakly_canonical( input, ec ) ).second ) {
+            continue;
+        }
+        BatchItem item;
+        item.input = input;
+        //Split output goes to a directory per device
+        item.output = outputDir / input::stemOf( input.string() );
+        if( !options.count( "split" ) ) {
+            item.output.concat( ".hpp" );
+        }
+        auto [owner, inserted] = outputOwners.emplace( item.output, input );
+        if( !inserted ) {
+            item.result.status = EGenerationStatus::Failed;
+            item.result.message = "Output " + item.output.string() + " is already produced from "
+                + owner->second.string();
+        }
+        items.push_back( std::move( item ) );
+    }
+}
+
+void BatchRunner::run( unsigned int jobs )
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::error_code ec;
+    fs::create_directories( outputDir, ec );
+    //Headers of all devices share the directory and the runtime in it
+    if( !options.count( "split" ) && !options.count( "no-runtime" ) && !runtime::writeRegBase( outputDir ) ) {
+        specErrors.push_back( "Failed to write " + std::string( runtime::regBaseName ) + " to " + outputDir.string() );
+    }
+    //The workers already run in parallel, each device is emitted serially
+    const Generator generator( options, 1 );
+    WorkerPool( jobs ).run( items.size(), [&]( std::size_t index ) {
+        BatchItem& item = items[index];
+        if( item.result.ok() ) {
+            item.result = generator.run( item.input.string(), item.output.string() );
+        }
+    } );
+    wallMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+}
+
+void BatchRunner::printSummary( std::ostream& os ) const
+{
+    std::size_t failed = 0;
+    double cpuMs = 0;
+    for( auto& error : specErrors ) {
+        os << "[ERROR] " << error << std::endl;
+    }
+    for( auto& item : items ) {
+        const auto& result = item.result;
+        failed += result.ok() ? 0 : 1;
+        cpuMs += result.totalMs();
+        os << ( result.ok() ? "[ OK ] " : "[FAIL] " ) << item.input.string() << std::fixed << std::setprecision( 1 );
+        if( result.cached ) {
+            os << "  cached, " << result.totalMs() << " ms" << std::endl;
+        }
+        else {
+            os << "  parse " << result.parseMs << " ms, emit " << result.emitMs << " ms, write " << result.writeMs
+               << " ms" << std::endl;
+        }
+        if( !result.ok() ) {
+            os << "       " << result.message << std::endl;
+        }
+        else if( result.dedup ) {
+            os << "       " << result.dedup->describe() << std::endl;
+        }
+    }
+    os << items.size() - failed << "/" << items.size() << " devices generated in " << std::fixed
+       << std::setprecision( 1 ) << wallMs << " ms (" << cpuMs << " ms summed over workers)" << std::endl;
+}
+
+bool BatchRunner::allSucceeded() const
+{
+    return specErrors.empty()
+        && std::all_of( items.begin(), items.end(), []( const BatchItem& item ) { return item.result.ok(); } );
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Generator.hpp"
+
+#include <cxxopts.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct BatchItem
+{
+    std::filesystem::path input;
+    std::filesystem::path output;
+    GenerationResult result;
+};
+
+// Converts many SVD files in one invocation on a bounded worker pool.
+// Inputs may be directories (searched recursively for *.svd), glob patterns
+// or manifest files given as "@path" with one input per line.
+struct BatchRunner
+{
+    BatchRunner( const cxxopts::ParseResult& options_,
+        const std::vector< std::string >& inputSpecs,
+        const std::filesystem::path& outputDir_ );
+    void run( unsigned int jobs );
+    void printSummary( std::ostream& os ) const;
+    bool allSucceeded() const;
+    inline const std::vector< BatchItem >& getItems() const
+    {
+        return items;
+    }
+
+private:
+    void collectInputs( const std::string& spec, std::vector< std::filesystem::path >& inputs );
+    void assignOutputs( const std::vector< std::filesystem::path >& inputs );
+
+private:
+    const cxxopts::ParseResult& options;
+    const std::filesystem::path outputDir;
+    std::vector< BatchItem > items;
+    std::vector< std::string > specErrors;
+    double wallMs = 0;
+};
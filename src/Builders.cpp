@@ -1,106 +1,369 @@
-#include "Builders.hpp"
-
-#include <bitset>
-#include <iostream>
-#include <fmt/core.h>
-
-std::string toCamelCase(const std::string& str)
-{
-    std::stringstream ss;
-    bool capitalize = true;
-    for (char c : str)
-    {
-        if (c == ' ' || c == '_')
-        {
-            capitalize = true;
-        }
-        else if (capitalize)
-        {
-            ss << static_cast<char>(std::toupper(c));
-            capitalize = false;
-        }
-        else
-        {
-            ss << static_cast<char>(std::tolower(c));
-        }
-    }
-    // Check if the last character of the original string is an underscore
-    if (!str.empty() && str.back() == '_')
-    {
-        // If so, append an underscore to the result string
-        ss << '_';
-    }
-    return ss.str();
-}
-
-void NSBeginBuilder::build(std::stringstream &ss) const
-{
-    ss << fmt::format(
-        "#pragma once\n"
-        "#include \"RegBase.h\"\n\n"
-        "namespace FEmbed {{\n"
-        );
-}
-
-void NSEnduilder::build(std::stringstream& ss ) const
-{
-    ss << fmt::format("}};\n");
-}
-
-void FieldDefineBuilder::build( std::stringstream& ss ) const
-{
-    // Do nothing...
-}
-
-void PeripheralBuilder::build( std::stringstream& ss ) const
-{
-//    ss << "namespace " << peripheral.name << "{\n";
-//    for( auto& registe : peripheral.registers ) {
-//        RegisterBuilder( registe, peripheral.baseAddress ).build( ss );
-//    }
-//    ss << "}\n\n";
-    ss <<   "template<typename _T = uint32_t, _T BaseAddr = 0x" << std::hex << peripheral.baseAddress << std::dec << ">\n"
-            "class " << toCamelCase(peripheral.name) << " {\n"
-            "  public:";
-        for( auto& registe : peripheral.registers ) {
-        RegisterBuilder( registe, peripheral.baseAddress ).build( ss );
-    }
-    ss << "};\n\n";
-
-}
-
-void RegisterBuilder::build( std::stringstream& ss ) const
-{
-    ss <<
-    "    class " << toCamelCase(registe.name) << " : public Register<_T, BaseAddr + " << registe.addressOffset << "> {\n"
-    "      public:\n"
-    "        constexpr static _T RegisterAddr =  BaseAddr + " << registe.addressOffset << ";\n"
-    "        constexpr static inline unsigned int address() { return RegisterAddr; }\n";
-
-    for( auto& field : registe.fields ) {
-        FieldBuilder( field, getRegisterAddress() ).build( ss );
-    }
-    ss <<
-    "    } " << registe.name << ";\n\n";
-}
-
-unsigned int RegisterBuilder::getRegisterAddress() const
-{
-    return baseAddress + registe.addressOffset;
-}
-
-void FieldBuilder::build( std::stringstream& ss ) const
-{
-    ss <<
-    "        Filed<_T, RegisterAddr, "<< field.bitOffset << ", "<< field.bitWidth <<"> " << field.name << ";\n";
-}
-
-unsigned int FieldBuilder::getAddress() const
-{
-    return registerAddress;
-}
-
-void FunctionsBuilder::build( std::stringstream& ss ) const
-{
-
-}
+#include "Builders.hpp"
+#include "DimArray.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <fmt/format.h>
+
+std::string toCamelCase(std::string_view str)
+{
+    std::string result;
+    result.reserve( str.size() + 1 );
+    bool capitalize = true;
+    for (char c : str)
+    {
+        if (c == ' ' || c == '_')
+        {
+            capitalize = true;
+        }
+        else if (capitalize)
+        {
+            result += static_cast<char>(std::toupper(c));
+            capitalize = false;
+        }
+        else
+        {
+            result += static_cast<char>(std::tolower(c));
+        }
+    }
+    // Check if the last character of the original string is an underscore
+    if (!str.empty() && str.back() == '_')
+    {
+        // If so, append an underscore to the result string
+        result += '_';
+    }
+    return result;
+}
+
+std::string fieldLayoutName( const DeviceModel& model, std::uint32_t layout )
+{
+    const RegisterRecord& registe = model.registerAt( model.getFieldLayouts()[layout] );
+    return fmt::format( "{}Fields{}", toCamelCase( model.str( registe.name ) ), layout );
+}
+
+// Name of the runtime indexed accessor of a register array, "Ch" -> "ch"
+std::string arrayAccessorName( std::string_view className )
+{
+    static const std::string_view keywords[] = { "and", "asm", "do", "for", "if", "int", "new", "not", "or", "try", "xor" };
+    std::string name( className );
+    if( !name.empty() ) {
+        name[0] = static_cast< char >( std::tolower( name[0] ) );
+    }
+    for( auto keyword : keywords ) {
+        if( name == keyword ) {
+            name += '_';
+        }
+    }
+    return name;
+}
+
+std::string valueTypeOf( const RegisterRecord& registe )
+{
+    for( unsigned int bits : { 8, 16, 32, 64 } ) {
+        if( registe.size != 0 && registe.size <= bits ) {
+            return fmt::format( "uint{}_t", bits );
+        }
+    }
+    return "_T";
+}
+
+// Registers without a size are _T, assumed to be 32 bits wide
+unsigned int valueBytesOf( const RegisterRecord& registe )
+{
+    for( unsigned int bits : { 8, 16, 32, 64 } ) {
+        if( registe.size != 0 && registe.size <= bits ) {
+            return bits / 8;
+        }
+    }
+    return 4;
+}
+
+std::string_view accessName( EAccess access )
+{
+    switch( access ) {
+    case EAccess::Read_Only:
+        return "Access::ReadOnly";
+    case EAccess::Write_Only:
+        return "Access::WriteOnly";
+    default:
+        return "Access::ReadWrite";
+    }
+}
+
+// Register<> base of a register class, reset value and access are left out
+// while they are the runtime's defaults
+std::string registerBase( const RegisterRecord& registe, std::string_view address )
+{
+    std::string base = fmt::format( "Register<{}, {}", valueTypeOf( registe ), address );
+    std::uint64_t resetValue = registe.resetValue;
+    if( registe.size != 0 && registe.size < 64 ) {
+        resetValue &= ( std::uint64_t( 1 ) << registe.size ) - 1;
+    }
+    if( resetValue != 0 || registe.registerAccess != EAccess::Read_Write ) {
+        fmt::format_to( std::back_inserter( base ), ", 0x{:x}", resetValue );
+    }
+    if( registe.registerAccess != EAccess::Read_Write ) {
+        fmt::format_to( std::back_inserter( base ), ", {}", accessName( registe.registerAccess ) );
+    }
+    return base + ">";
+}
+
+std::uint32_t classOf( const DeviceModel& model, const PeripheralRecord& peripheral, const EmitOptions& emit )
+{
+    if( model.hasOwnLayout( peripheral )
+        || emit.atomic.policyOf( model, peripheral )
+            != emit.atomic.policyOf( model, model.peripheralAt( peripheral.layout ) ) ) {
+        return model.indexOf( peripheral );
+    }
+    return peripheral.layout;
+}
+
+void NSBeginBuilder::build( OutputSink& out ) const
+{
+    out += "#pragma once\n";
+    for( auto& include : includes ) {
+        fmt::format_to( std::back_inserter( out ), "#include \"{}\"\n", include );
+    }
+    out += "\nnamespace FEmbed {\n";
+}
+
+void NSEnduilder::build( OutputSink& out ) const
+{
+    out += "};\n";
+}
+
+void FieldDefineBuilder::build( OutputSink& out ) const
+{
+    // Do nothing...
+}
+
+void FieldLayoutBuilder::build( OutputSink& out ) const
+{
+    const RegisterRecord& registe = model.registerAt( model.getFieldLayouts()[layout] );
+    //_R is the register class inheriting the layout
+    fmt::format_to( std::back_inserter( out ),
+        "template<typename _R>\n"
+        "class {} {{\n"
+        "  public:\n",
+        fieldLayoutName( model, layout ) );
+    for( auto& field : model.fieldsOf( registe ) ) {
+        FieldBuilder( model, field, registe.addressOffset, "_R" ).build( out );
+    }
+    out += "};\n\n";
+}
+
+void PeripheralBuilder::build( OutputSink& out ) const
+{
+    fmt::format_to( std::back_inserter( out ), "template<typename _T = uint32_t, _T BaseAddr = 0x{:x}>\n",
+        peripheral.baseAddress );
+    const std::uint32_t owner = classOf( model, peripheral, emit );
+    if( owner != model.indexOf( peripheral ) ) {
+        //Same registers as its base, so only the base address differs
+        const PeripheralRecord& layout = model.peripheralAt( owner );
+        fmt::format_to( std::back_inserter( out ), "using {} = {}<_T, BaseAddr>;\n\n",
+            toCamelCase( model.str( peripheral.name ) ), toCamelCase( model.str( layout.name ) ) );
+        return;
+    }
+    fmt::format_to( std::back_inserter( out ),
+        "class {} {{\n"
+        "  public:",
+        toCamelCase( model.str( peripheral.name ) ) );
+    const auto registers = model.registersOf( peripheral );
+    std::vector< std::string > members( registers.size() );
+    if( emit.overlay ) {
+        members = buildLayout( out );
+    }
+    const std::string atomicPolicy = emit.atomic.policyOf( model, peripheral );
+    std::size_t index = 0;
+    for( auto& registe : registers ) {
+        RegisterBuilder( model, registe, peripheral.baseAddress, std::move( members[index++] ), atomicPolicy,
+            emit.lean )
+            .build( out );
+    }
+    out += "};\n\n";
+}
+
+std::vector< std::string > PeripheralBuilder::buildLayout( OutputSink& out ) const
+{
+    const auto registers = model.registersOf( peripheral );
+    std::vector< std::size_t > byOffset( registers.size() );
+    for( std::size_t i = 0; i < byOffset.size(); ++i ) {
+        byOffset[i] = i;
+    }
+    std::stable_sort( byOffset.begin(), byOffset.end(), [&]( std::size_t a, std::size_t b ) {
+        return registers[a].addressOffset < registers[b].addressOffset;
+    } );
+
+    auto it = std::back_inserter( out );
+    std::vector< std::string > members( registers.size() );
+    std::string checks;
+    std::uint64_t end = 0;
+    unsigned int reserved = 0;
+    out += "\n    struct _Layout {\n";
+    for( std::size_t i : byOffset ) {
+        const RegisterRecord& registe = registers[i];
+        const unsigned int bytes = valueBytesOf( registe );
+        const unsigned int count = registe.dim == 0 ? 1 : registe.dim;
+        if( registe.addressOffset < end || registe.addressOffset % bytes != 0
+            || ( registe.dim != 0 && registe.dimIncrement != bytes ) ) {
+            continue;
+        }
+        if( registe.addressOffset > end ) {
+            fmt::format_to( it, "        uint8_t _reserved{}[{}];\n", reserved++, registe.addressOffset - end );
+        }
+        const std::string name = registe.dim == 0 ? std::string( model.str( registe.name ) )
+                                                  : svd::dimBaseName( model.str( registe.name ) );
+        if( registe.dim == 0 ) {
+            fmt::format_to( it, "        volatile {} {};\n", valueTypeOf( registe ), name );
+            members[i] = name;
+        }
+        else {
+            const unsigned int first = svd::dimFirstIndex( model.str( registe.dimIndex ), registe.dim );
+            fmt::format_to( it, "        volatile {} {}[{}];\n", valueTypeOf( registe ), name, count );
+            members[i] = first == 0 ? fmt::format( "{}[N]", name ) : fmt::format( "{}[N - {}]", name, first );
+        }
+        fmt::format_to( std::back_inserter( checks ),
+            "    static_assert( offsetof( _Layout, {0} ) == {1}, \"{0} isn't at its addressOffset\" );\n", name,
+            registe.addressOffset );
+        end = registe.addressOffset + std::uint64_t( bytes ) * count;
+    }
+    const std::uint64_t blockEnd = std::uint64_t( peripheral.addressBlockOffset ) + peripheral.addressBlockSize;
+    if( peripheral.addressBlockSize != 0 && blockEnd > end ) {
+        fmt::format_to( it, "        uint8_t _reserved{}[{}];\n", reserved, blockEnd - end );
+    }
+    fmt::format_to( it,
+        "    }};\n"
+        "{}"
+        "    static inline _Layout* _layout() {{ return reinterpret_cast<_Layout*>( BaseAddr ); }}\n\n",
+        checks );
+    return members;
+}
+
+void RegisterBuilder::build( OutputSink& out ) const
+{
+    if( registe.dim != 0 ) {
+        buildArray( out );
+        return;
+    }
+    auto it = std::back_inserter( out );
+    const std::string name = toCamelCase( model.str( registe.name ) );
+    fmt::format_to( it, "    class {} : public {}", name,
+        registerBase( registe, fmt::format( "BaseAddr + {}", registe.addressOffset ) ) );
+    if( registe.fieldLayout != noFieldLayout ) {
+        fmt::format_to( it, ", public {}<{}>", fieldLayoutName( model, registe.fieldLayout ), name );
+    }
+    out += " {\n"
+           "      public:\n";
+    if( !lean ) {
+        fmt::format_to( it,
+            "        constexpr static _T RegisterAddr =  BaseAddr + {};\n"
+            "        constexpr static inline unsigned int address() {{ return RegisterAddr; }}\n",
+            registe.addressOffset );
+    }
+    if( !overlayMember.empty() ) {
+        fmt::format_to( it, "        static inline volatile {}& ref() {{ return _layout()->{}; }}\n",
+            valueTypeOf( registe ), overlayMember );
+    }
+    if( !atomicPolicy.empty() ) {
+        fmt::format_to( it, "        using Atomic = {};\n", atomicPolicy );
+    }
+
+    if( registe.fieldLayout == noFieldLayout ) {
+        for( auto& field : model.fieldsOf( registe ) ) {
+            FieldBuilder( model, field, getRegisterAddress(), name ).build( out );
+        }
+    }
+    if( lean ) {
+        out += "    };\n";
+        return;
+    }
+    fmt::format_to( it, "    }} {};\n\n", model.str( registe.name ) );
+}
+
+void RegisterBuilder::buildArray( OutputSink& out ) const
+{
+    //One class template for every element, N is the element number
+    auto it = std::back_inserter( out );
+    const std::string name = toCamelCase( svd::dimBaseName( model.str( registe.name ) ) );
+    const unsigned int first = svd::dimFirstIndex( model.str( registe.dimIndex ), registe.dim );
+    auto elementAddress = [&]( std::string_view index ) {
+        return first == 0
+            ? fmt::format( "BaseAddr + {} + {} * {}", registe.addressOffset, index, registe.dimIncrement )
+            : fmt::format( "BaseAddr + {} + ( {} - {} ) * {}", registe.addressOffset, index, first, registe.dimIncrement );
+    };
+    const std::string address = elementAddress( "N" );
+    const std::string valueType = valueTypeOf( registe );
+    fmt::format_to( it,
+        "    template<unsigned int N>\n"
+        "    class {} : public {}",
+        name, registerBase( registe, address ) );
+    if( registe.fieldLayout != noFieldLayout ) {
+        fmt::format_to( it, ", public {}<{}<N>>", fieldLayoutName( model, registe.fieldLayout ), name );
+    }
+    auto elementRange = [&]( std::string_view index ) {
+        return first == 0 ? fmt::format( "{} < {}", index, registe.dim )
+                          : fmt::format( "{0} >= {1} && {0} < {2}", index, first, first + registe.dim );
+    };
+    fmt::format_to( it,
+        " {{\n"
+        "      public:\n"
+        "        static_assert( {}, \"{} index out of range\" );\n",
+        elementRange( "N" ), svd::dimBaseName( model.str( registe.name ) ) );
+    if( !lean ) {
+        fmt::format_to( it,
+            "        constexpr static _T RegisterAddr =  {};\n"
+            "        constexpr static inline unsigned int address() {{ return RegisterAddr; }}\n",
+            address );
+    }
+    if( !overlayMember.empty() ) {
+        fmt::format_to( it, "        static inline volatile {}& ref() {{ return _layout()->{}; }}\n", valueType,
+            overlayMember );
+    }
+    if( !atomicPolicy.empty() ) {
+        fmt::format_to( it, "        using Atomic = {};\n", atomicPolicy );
+    }
+
+    if( registe.fieldLayout == noFieldLayout ) {
+        for( auto& field : model.fieldsOf( registe ) ) {
+            FieldBuilder( model, field, getRegisterAddress(), name ).build( out );
+        }
+    }
+    //The runtime accessor is an unchecked escape hatch: the raw element, asserted
+    //to be in range in debug builds, through _Layout like ref() when it has one
+    std::string element = fmt::format( "*reinterpret_cast<volatile {}*>( {} )", valueType, elementAddress( "index" ) );
+    if( !overlayMember.empty() ) {
+        element = "_layout()->" + overlayMember;
+        element.replace( element.find( "[N" ) + 1, 1, "index" );
+    }
+    fmt::format_to( it,
+        "    }};\n"
+        "    static inline volatile {0}& {1}( unsigned int index ) {{ assert( {2} ); return {3}; }}\n{4}",
+        valueType, arrayAccessorName( name ), elementRange( "index" ), element, lean ? "" : "\n" );
+}
+
+unsigned int RegisterBuilder::getRegisterAddress() const
+{
+    return baseAddress + registe.addressOffset;
+}
+
+void FieldBuilder::build( OutputSink& out ) const
+{
+    auto it = std::back_inserter( out );
+    fmt::format_to( it, "        using {} = Filed<{}, {}, {}", model.str( field.name ), registerType, field.bitOffset,
+        field.bitWidth );
+    if( field.fieldAccess != EAccess::Read_Write ) {
+        fmt::format_to( it, ", {}", accessName( field.fieldAccess ) );
+    }
+    out += ">;\n";
+}
+
+unsigned int FieldBuilder::getAddress() const
+{
+    return registerAddress;
+}
+
+void FunctionsBuilder::build( OutputSink& out ) const
+{
+
+}
@@ -1,68 +1,160 @@
-#pragma once
-
-#include "IBuilder.hpp"
-#include "Peripheral.hpp"
-
-#include <sstream>
-
-struct NSBeginBuilder : public IBuilder
-{
-    void build( std::stringstream& ss ) const final;
-};
-
-struct NSEnduilder : public IBuilder
-{
-    void build( std::stringstream& ss ) const final;
-};
-
-struct FieldDefineBuilder : public IBuilder
-{
-    void build( std::stringstream& ss ) const final;
-};
-
-struct PeripheralBuilder : public IBuilder
-{
-    PeripheralBuilder( const Peripheral& peripheral_ )
-        : peripheral( peripheral_ )
-    {
-    }
-    void build( std::stringstream& ss ) const final;
-
-private:
-    const Peripheral& peripheral;
-};
-
-struct RegisterBuilder : public IBuilder
-{
-    RegisterBuilder( const Register& register_, const unsigned int baseAddress_ )
-        : registe( register_ )
-        , baseAddress( baseAddress_ )
-    {
-    }
-    void build( std::stringstream& ss ) const final;
-    unsigned int getRegisterAddress() const;
-
-private:
-    const Register& registe;
-    const unsigned int baseAddress;
-};
-
-struct FieldBuilder : public IBuilder
-{
-    FieldBuilder( const Field& field_, const unsigned int registerAddress_ )
-        : field( field_ )
-        , registerAddress( registerAddress_ )
-    {
-    }
-    void build( std::stringstream& ss ) const final;
-    unsigned int getAddress() const;
-
-private:
-    const Field& field;
-    const unsigned int registerAddress;
-};
-
-struct FunctionsBuilder : public IBuilder
-{
-    void build( std::stringstream& ss ) const final;
-};
+#pragma once
+
+#include "AtomicPolicy.hpp"
+#include "DeviceModel.hpp"
+#include "IBuilder.hpp"
+
+#include <string>
+#include <vector>
+
+// Version of the generated code, part of the regeneration cache key so cached
+// headers of an older generator are never restored. Bump it with every change
+// to what the builders emit.
+constexpr unsigned int outputFormatVersion = 3;
+
+// Output variants selected on the command line
+struct EmitOptions
+{
+    // Registers are reached through a volatile struct overlaying their
+    // peripheral, see PeripheralBuilder
+    bool overlay = false;
+    // Registers are only types: no RegisterAddr/address() helpers, they are
+    // on Register<>, and no data member per register, which would make
+    // every use of the peripheral instantiate all of its register classes
+    bool lean = false;
+    AtomicPolicies atomic;
+};
+
+// Model index of the peripheral whose class the peripheral is an alias of, its
+// own index when it gets a class. The atomic policy is part of the class, so
+// an alias whose policy differs from its layout's gets a class of its own.
+std::uint32_t classOf( const DeviceModel& model, const PeripheralRecord& peripheral, const EmitOptions& emit );
+
+struct NSBeginBuilder : public IBuilder
+{
+    NSBeginBuilder( std::vector< std::string > includes_ = { "RegBase.h" } )
+        : includes( std::move( includes_ ) )
+    {
+    }
+    void build( OutputSink& out ) const final;
+
+private:
+    const std::vector< std::string > includes;
+};
+
+struct NSEnduilder : public IBuilder
+{
+    void build( OutputSink& out ) const final;
+};
+
+struct FieldDefineBuilder : public IBuilder
+{
+    void build( OutputSink& out ) const final;
+};
+
+// Field layout shared by several registers, see Deduplicator
+struct FieldLayoutBuilder : public IBuilder
+{
+    FieldLayoutBuilder( const DeviceModel& model_, const std::uint32_t layout_ )
+        : model( model_ )
+        , layout( layout_ )
+    {
+    }
+    void build( OutputSink& out ) const final;
+
+private:
+    const DeviceModel& model;
+    const std::uint32_t layout;
+};
+
+struct PeripheralBuilder : public IBuilder
+{
+    PeripheralBuilder( const DeviceModel& model_, const PeripheralRecord& peripheral_, const EmitOptions& emit_ )
+        : model( model_ )
+        , peripheral( peripheral_ )
+        , emit( emit_ )
+    {
+    }
+    void build( OutputSink& out ) const final;
+
+private:
+    // With overlay the class gets a _Layout struct with one volatile member
+    // per register at its addressOffset, padded up to the end of the
+    // addressBlock, and registers are accessed through _layout()->REG so
+    // accesses to several registers share one base address. Registers that
+    // overlap another one or aren't aligned to their size stay absolute.
+    // Returns the member expression of every register, empty if it has none.
+    std::vector< std::string > buildLayout( OutputSink& out ) const;
+
+private:
+    const DeviceModel& model;
+    const PeripheralRecord& peripheral;
+    const EmitOptions& emit;
+};
+
+struct RegisterBuilder : public IBuilder
+{
+    RegisterBuilder( const DeviceModel& model_,
+        const RegisterRecord& register_,
+        const unsigned int baseAddress_,
+        std::string overlayMember_ = {},
+        std::string atomicPolicy_ = {},
+        bool lean_ = false )
+        : model( model_ )
+        , registe( register_ )
+        , baseAddress( baseAddress_ )
+        , overlayMember( std::move( overlayMember_ ) )
+        , atomicPolicy( std::move( atomicPolicy_ ) )
+        , lean( lean_ )
+    {
+    }
+    // Register<> gets the unsigned type of the register's size, its reset
+    // value and access, Filed<> the register class
+    void build( OutputSink& out ) const final;
+    unsigned int getRegisterAddress() const;
+
+private:
+    // <dim> arrays become a class template indexed by the element number plus
+    // an unchecked function taking a runtime index
+    void buildArray( OutputSink& out ) const;
+
+private:
+    const DeviceModel& model;
+    const RegisterRecord& registe;
+    const unsigned int baseAddress;
+    // Member of the peripheral's _Layout the register's ref() returns
+    const std::string overlayMember;
+    // Runtime Atomic policy of the register, see AtomicPolicies
+    const std::string atomicPolicy;
+    // See EmitOptions::lean
+    const bool lean;
+};
+
+struct FieldBuilder : public IBuilder
+{
+    FieldBuilder( const DeviceModel& model_,
+        const FieldRecord& field_,
+        const unsigned int registerAddress_,
+        std::string registerType_ )
+        : model( model_ )
+        , field( field_ )
+        , registerAddress( registerAddress_ )
+        , registerType( std::move( registerType_ ) )
+    {
+    }
+    void build( OutputSink& out ) const final;
+    unsigned int getAddress() const;
+
+private:
+    const DeviceModel& model;
+    const FieldRecord& field;
+    const unsigned int registerAddress;
+    // Register class the field belongs to, it provides the value type, the
+    // address, the reset value and the register's access
+    const std::string registerType;
+};
+
+struct FunctionsBuilder : public IBuilder
+{
+    void build( OutputSink& out ) const final;
+};
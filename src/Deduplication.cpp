@@ -0,0 +1,215 @@
+#include "Deduplication.hpp"
+#include "Builders.hpp"
+
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::size_t combine( std::size_t seed, std::size_t value )
+{
+    return seed ^ ( value + 0x9e3779b97f4a7c15ull + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+// Strings are interned, so equal strings have equal handles
+bool same( StringRef lhs, StringRef rhs )
+{
+    return lhs.offset == rhs.offset && lhs.length == rhs.length;
+}
+
+std::size_t hashOf( StringRef ref )
+{
+    return combine( ref.offset, ref.length );
+}
+
+// Only what ends up in the header counts, descriptions don't
+bool sameFields( const DeviceModel& model, const RegisterRecord& lhs, const RegisterRecord& rhs )
+{
+    if( lhs.fieldCount != rhs.fieldCount ) {
+        return false;
+    }
+    auto lhsFields = model.fieldsOf( lhs );
+    auto rhsFields = model.fieldsOf( rhs );
+    for( std::size_t i = 0; i < lhsFields.size(); ++i ) {
+        const FieldRecord& a = lhsFields[i];
+        const FieldRecord& b = rhsFields[i];
+        if( !same( a.name, b.name ) || a.bitOffset != b.bitOffset || a.bitWidth != b.bitWidth
+            || a.fieldAccess != b.fieldAccess ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t hashFields( const DeviceModel& model, const RegisterRecord& registe )
+{
+    std::size_t seed = registe.fieldCount;
+    for( auto& field : model.fieldsOf( registe ) ) {
+        seed = combine( seed, hashOf( field.name ) );
+        seed = combine( seed, field.bitOffset );
+        seed = combine( seed, field.bitWidth );
+        seed = combine( seed, static_cast< std::size_t >( field.fieldAccess ) );
+    }
+    return seed;
+}
+
+//The atomic policy is part of the class, so peripherals with different
+//policies never share one
+bool sameRegisters( const DeviceModel& model,
+    const AtomicPolicies& atomic,
+    const PeripheralRecord& lhs,
+    const PeripheralRecord& rhs )
+{
+    if( lhs.registerCount != rhs.registerCount || atomic.policyOf( model, lhs ) != atomic.policyOf( model, rhs ) ) {
+        return false;
+    }
+    auto lhsRegisters = model.registersOf( lhs );
+    auto rhsRegisters = model.registersOf( rhs );
+    for( std::size_t i = 0; i < lhsRegisters.size(); ++i ) {
+        const RegisterRecord& a = lhsRegisters[i];
+        const RegisterRecord& b = rhsRegisters[i];
+        if( !same( a.name, b.name ) || a.addressOffset != b.addressOffset || a.size != b.size
+            || a.resetValue != b.resetValue || a.registerAccess != b.registerAccess || a.dim != b.dim
+            || a.dimIncrement != b.dimIncrement || !same( a.dimIndex, b.dimIndex ) || !sameFields( model, a, b ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t hashRegisters( const DeviceModel& model, const AtomicPolicies& atomic, const PeripheralRecord& peripheral )
+{
+    std::size_t seed = combine( peripheral.registerCount, std::hash< std::string >{}( atomic.policyOf( model, peripheral ) ) );
+    for( auto& registe : model.registersOf( peripheral ) ) {
+        seed = combine( seed, hashOf( registe.name ) );
+        seed = combine( seed, registe.addressOffset );
+        seed = combine( seed, registe.size );
+        seed = combine( seed, std::hash< std::uint64_t >{}( registe.resetValue ) );
+        seed = combine( seed, static_cast< std::size_t >( registe.registerAccess ) );
+        seed = combine( seed, registe.dim );
+        seed = combine( seed, hashFields( model, registe ) );
+    }
+    return seed;
+}
+
+long long emittedSize( const IBuilder& builder )
+{
+    OutputSink out;
+    builder.build( out );
+    return static_cast< long long >( out.size() );
+}
+
+// Hash buckets holding the indexes of the distinct representatives seen so far
+template< typename Same >
+std::uint32_t findOrAdd( std::unordered_map< std::size_t, std::vector< std::uint32_t > >& buckets,
+    std::size_t hash,
+    std::uint32_t index,
+    Same same )
+{
+    auto& bucket = buckets[hash];
+    for( auto representative : bucket ) {
+        if( same( representative ) ) {
+            return representative;
+        }
+    }
+    bucket.push_back( index );
+    return index;
+}
+
+} // namespace
+
+std::string DedupStats::describe() const
+{
+    std::ostringstream ss;
+    ss << "Deduplication: " << peripheralTypes << " peripheral classes aliased, " << registerTypes
+       << " registers share " << fieldLayouts << " field layouts, " << bytesSaved << " bytes saved";
+    return ss.str();
+}
+
+DedupStats Deduplicator::run( DeviceModel& model, const AtomicPolicies& atomic )
+{
+    DedupStats stats;
+    auto& peripherals = model.peripherals;
+    auto& registers = model.registers;
+
+    //Peripherals with their own class and an identical earlier class become aliases of it
+    std::unordered_map< std::size_t, std::vector< std::uint32_t > > buckets;
+    std::vector< std::uint32_t > replacedBy( peripherals.size(), noPeripheral );
+    for( std::uint32_t i = 0; i < peripherals.size(); ++i ) {
+        if( !model.hasOwnLayout( peripherals[i] ) ) {
+            continue;
+        }
+        const std::uint32_t representative =
+            findOrAdd( buckets, hashRegisters( model, atomic, peripherals[i] ), i, [&]( std::uint32_t other ) {
+                return sameRegisters( model, atomic, peripherals[other], peripherals[i] );
+            } );
+        if( representative != i ) {
+            replacedBy[i] = representative;
+            ++stats.peripheralTypes;
+        }
+    }
+    //Move the replaced classes and everything aliasing them over to the representative
+    const EmitOptions emit;
+    for( auto& peripheral : peripherals ) {
+        const std::uint32_t target = replacedBy[peripheral.layout];
+        if( target == noPeripheral ) {
+            continue;
+        }
+        stats.bytesSaved += emittedSize( PeripheralBuilder( model, peripheral, emit ) );
+        peripheral.layout = target;
+        stats.bytesSaved -= emittedSize( PeripheralBuilder( model, peripheral, emit ) );
+    }
+
+    //Group the registers of the remaining classes by their field lists
+    buckets.clear();
+    std::vector< std::vector< std::pair< std::uint32_t, std::uint32_t > > > groups;
+    std::unordered_map< std::uint32_t, std::size_t > groupOf;
+    for( auto& peripheral : peripherals ) {
+        if( !model.hasOwnLayout( peripheral ) ) {
+            continue;
+        }
+        for( auto& registe : model.registersOf( peripheral ) ) {
+            if( registe.fieldCount == 0 ) {
+                continue;
+            }
+            const std::uint32_t index = static_cast< std::uint32_t >( &registe - registers.data() );
+            const std::uint32_t representative =
+                findOrAdd( buckets, hashFields( model, registe ), index, [&]( std::uint32_t other ) {
+                    return sameFields( model, registers[other], registe );
+                } );
+            auto [group, isNew] = groupOf.emplace( representative, groups.size() );
+            if( isNew ) {
+                groups.emplace_back();
+            }
+            groups[group->second].emplace_back( index, peripheral.baseAddress );
+        }
+    }
+
+    //Share a layout only where it makes the header smaller
+    for( auto& group : groups ) {
+        if( group.size() < 2 ) {
+            continue;
+        }
+        const std::uint32_t layout = static_cast< std::uint32_t >( model.fieldLayouts.size() );
+        model.fieldLayouts.push_back( group.front().first );
+        long long saved = -emittedSize( FieldLayoutBuilder( model, layout ) );
+        for( auto [index, baseAddress] : group ) {
+            saved += emittedSize( RegisterBuilder( model, registers[index], baseAddress ) );
+            registers[index].fieldLayout = layout;
+            saved -= emittedSize( RegisterBuilder( model, registers[index], baseAddress ) );
+        }
+        if( saved <= 0 ) {
+            for( auto [index, baseAddress] : group ) {
+                registers[index].fieldLayout = noFieldLayout;
+            }
+            model.fieldLayouts.pop_back();
+            continue;
+        }
+        stats.registerTypes += group.size();
+        ++stats.fieldLayouts;
+        stats.bytesSaved += saved;
+    }
+    return stats;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "AtomicPolicy.hpp"
+#include "DeviceModel.hpp"
+
+#include <cstddef>
+#include <string>
+
+struct DedupStats
+{
+    // Peripheral classes replaced by an alias of an identical class
+    std::size_t peripheralTypes = 0;
+    // Registers whose fields now come from a shared layout
+    std::size_t registerTypes = 0;
+    // Shared field layouts emitted once for those registers
+    std::size_t fieldLayouts = 0;
+    // Header bytes saved, after paying for the shared layouts
+    long long bytesSaved = 0;
+
+    std::string describe() const;
+};
+
+// Optional pass between parsing and emission. Finds peripherals with the same
+// register set and registers with the same field list by structural hashing,
+// even when they aren't related through derivedFrom, and makes them share one
+// emitted type. Peripherals only share a class when they also get the same
+// atomic policy.
+struct Deduplicator
+{
+    static DedupStats run( DeviceModel& model, const AtomicPolicies& atomic = {} );
+};
@@ -0,0 +1,320 @@
+#include "Derivation.hpp"
+#include "logging.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace svd {
+
+namespace {
+
+enum class EState
+{
+    Unresolved,
+    InProgress,
+    Resolved
+};
+
+struct Resolver
+{
+    std::vector< Peripheral >& peripherals;
+    const std::vector< PeripheralDerivations >& derivations;
+    std::unordered_map< std::string_view, std::size_t > peripheralIndex;
+    // Register name indexes are only built for register lists that are looked into
+    std::unordered_map< const RegisterList*, std::unordered_map< std::string, std::size_t > > registerIndexes;
+    std::vector< EState > peripheralStates;
+
+    Resolver( std::vector< Peripheral >& peripherals_, const std::vector< PeripheralDerivations >& derivations_ )
+        : peripherals( peripherals_ )
+        , derivations( derivations_ )
+        , peripheralStates( peripherals_.size(), EState::Unresolved )
+    {
+        peripheralIndex.reserve( peripherals.size() );
+        for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+            //First definition wins, like a front to back search
+            peripheralIndex.emplace( peripherals[i].name, i );
+        }
+    }
+
+    // Follows derivedFrom to the register list that holds the peripheral's registers
+    RegisterList* registersOf( std::size_t peripheral ) const
+    {
+        for( std::size_t hops = 0; hops <= peripherals.size(); ++hops ) {
+            const Peripheral& current = peripherals[peripheral];
+            if( ( current.registers && !current.registers->empty() ) || current.derivedFrom.empty() ) {
+                return current.registers.get();
+            }
+            auto it = peripheralIndex.find( current.derivedFrom );
+            if( it == peripheralIndex.end() ) {
+                return nullptr;
+            }
+            peripheral = it->second;
+        }
+        return nullptr;
+    }
+
+    Register* findRegister( std::size_t peripheral, std::string_view name )
+    {
+        RegisterList* registers = registersOf( peripheral );
+        if( registers == nullptr ) {
+            return nullptr;
+        }
+        auto [indexIt, isNew] = registerIndexes.try_emplace( registers );
+        auto& index = indexIt->second;
+        if( isNew ) {
+            for( std::size_t i = 0; i < registers->size(); ++i ) {
+                index.emplace( ( *registers )[i].name, i );
+            }
+        }
+        auto it = index.find( std::string( name ) );
+        return it == index.end() ? nullptr : &( *registers )[it->second];
+    }
+
+    // "REG" within the peripheral or "PERIPHERAL.REG", optionally with the
+    // clusters leading to the register: "PERIPHERAL.CLUSTER.REG"
+    Register* findRegisterPath( std::size_t peripheral, std::string_view path )
+    {
+        const auto dot = path.find( '.' );
+        if( dot == std::string_view::npos ) {
+            return findRegister( peripheral, path );
+        }
+        auto it = peripheralIndex.find( path.substr( 0, dot ) );
+        if( it != peripheralIndex.end() ) {
+            peripheral = it->second;
+            path.remove_prefix( dot + 1 );
+        }
+        //Registers of flattened clusters are named "CLUSTER_REG"
+        std::string name( path );
+        std::replace( name.begin(), name.end(), '.', '_' );
+        return findRegister( peripheral, name );
+    }
+
+    // "FIELD" within the register, "REG.FIELD" or "PERIPHERAL.REG.FIELD"
+    const Field* findField( std::size_t peripheral, const Register& registe, std::string_view path )
+    {
+        const auto dot = path.rfind( '.' );
+        const Register* owner = &registe;
+        if( dot != std::string_view::npos ) {
+            owner = findRegisterPath( peripheral, path.substr( 0, dot ) );
+            if( owner == nullptr ) {
+                return nullptr;
+            }
+        }
+        const std::string_view name = dot == std::string_view::npos ? path : path.substr( dot + 1 );
+        for( auto& field : owner->fields ) {
+            if( field.name == name ) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+
+    void resolveFields( std::size_t peripheral )
+    {
+        RegisterList& registers = *peripherals[peripheral].registers;
+        for( auto& pending : derivations[peripheral].fields ) {
+            Register& registe = registers[pending.registe];
+            Field& derived = registe.fields[pending.field];
+            const Field* base = findField( peripheral, registe, derived.derivedFrom );
+            if( base == nullptr || base == &derived ) {
+                logging::getLogger( "parser" ).warn( "Couldn't find field {}", derived.derivedFrom );
+                continue;
+            }
+            inherit( derived, pending.specified, *base );
+        }
+    }
+
+    void inherit( Field& derived, unsigned int specified, const Field& base )
+    {
+        Field resolved = base;
+        resolved.name = derived.name;
+        resolved.derivedFrom = derived.derivedFrom;
+        if( specified & FieldDescription ) {
+            resolved.description = derived.description;
+        }
+        if( specified & FieldBitOffset ) {
+            resolved.bitOffset = derived.bitOffset;
+        }
+        if( specified & FieldBitWidth ) {
+            resolved.bitWidth = derived.bitWidth;
+        }
+        if( specified & FieldAccess ) {
+            resolved.fieldAccess = derived.fieldAccess;
+        }
+        derived = std::move( resolved );
+    }
+
+    void resolveRegisters( std::size_t peripheral )
+    {
+        RegisterList& registers = *peripherals[peripheral].registers;
+        const auto& pendings = derivations[peripheral].registers;
+        //Bases that are derived themselves are resolved first
+        std::unordered_map< const Register*, std::size_t > pendingOf;
+        for( std::size_t i = 0; i < pendings.size(); ++i ) {
+            pendingOf.emplace( &registers[pendings[i].registe], i );
+        }
+        std::vector< EState > states( pendings.size(), EState::Unresolved );
+        std::function< void( std::size_t ) > resolveOne = [&]( std::size_t i ) {
+            if( states[i] != EState::Unresolved ) {
+                return;
+            }
+            states[i] = EState::InProgress;
+            Register& derived = registers[pendings[i].registe];
+            const Register* base = findRegisterPath( peripheral, derived.derivedFrom );
+            auto basePending = pendingOf.find( base );
+            if( basePending != pendingOf.end() ) {
+                resolveOne( basePending->second );
+                base = states[basePending->second] == EState::Resolved ? base : nullptr;
+            }
+            if( base == nullptr ) {
+                logging::getLogger( "parser" ).warn( "Couldn't find register {}", derived.derivedFrom );
+            }
+            else {
+                inherit( derived, pendings[i].specified, *base );
+            }
+            states[i] = EState::Resolved;
+        };
+        for( std::size_t i = 0; i < pendings.size(); ++i ) {
+            resolveOne( i );
+        }
+    }
+
+    void inherit( Register& derived, unsigned int specified, const Register& base )
+    {
+        Register resolved = base;
+        resolved.name = derived.name;
+        resolved.derivedFrom = derived.derivedFrom;
+        resolved.specified |= derived.specified;
+        if( specified & RegisterDescription ) {
+            resolved.description = derived.description;
+        }
+        if( specified & RegisterAddressOffset ) {
+            resolved.addressOffset = derived.addressOffset;
+        }
+        if( specified & RegisterSize ) {
+            resolved.size = derived.size;
+        }
+        if( specified & RegisterAccess ) {
+            resolved.registerAccess = derived.registerAccess;
+        }
+        if( specified & RegisterResetValue ) {
+            resolved.resetValue = derived.resetValue;
+        }
+        if( specified & RegisterDim ) {
+            resolved.dim = derived.dim;
+        }
+        if( specified & RegisterDimIncrement ) {
+            resolved.dimIncrement = derived.dimIncrement;
+        }
+        if( specified & RegisterDimIndex ) {
+            resolved.dimIndex = std::move( derived.dimIndex );
+        }
+        if( specified & RegisterFields ) {
+            resolved.fields = std::move( derived.fields );
+        }
+        derived = std::move( resolved );
+    }
+
+    void resolvePeripheral( std::size_t index )
+    {
+        if( peripheralStates[index] != EState::Unresolved ) {
+            return;
+        }
+        peripheralStates[index] = EState::InProgress;
+        Peripheral& derived = peripherals[index];
+        if( !derived.derivedFrom.empty() ) {
+            auto it = peripheralIndex.find( derived.derivedFrom );
+            if( it == peripheralIndex.end() || peripheralStates[it->second] == EState::InProgress ) {
+                logging::getLogger( "parser" ).warn( "Couldn't find peripheral {}", derived.derivedFrom );
+            }
+            else {
+                resolvePeripheral( it->second );
+                inherit( derived, derivations[index].specified, peripherals[it->second] );
+            }
+        }
+        peripheralStates[index] = EState::Resolved;
+    }
+
+    void inherit( Peripheral& derived, unsigned int specified, const Peripheral& base )
+    {
+        if( !( specified & PeripheralDescription ) ) {
+            derived.description = base.description;
+        }
+        if( !( specified & PeripheralGroupName ) ) {
+            derived.groupName = base.groupName;
+        }
+        if( !( specified & PeripheralAddressBlock ) ) {
+            derived.addressBlock = base.addressBlock;
+        }
+        if( !derived.registers || derived.registers->empty() ) {
+            //Share instead of copying the base's registers
+            derived.registers = base.registers;
+            return;
+        }
+        //Own registers are added to the base ones, replacing same named registers
+        auto merged = std::make_shared< RegisterList >( base.getRegisters() );
+        for( auto& registe : *derived.registers ) {
+            auto crit = [&]( const Register& other ) { return other.name == registe.name; };
+            auto it = std::find_if( merged->begin(), merged->end(), crit );
+            if( it != merged->end() ) {
+                *it = registe;
+            }
+            else {
+                merged->push_back( registe );
+            }
+        }
+        derived.registers = std::move( merged );
+    }
+
+    void run()
+    {
+        //Fields and registers are resolved within their own lists first, then
+        //peripherals pick up the (now complete) register lists of their bases
+        for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+            if( !derivations[i].fields.empty() ) {
+                resolveFields( i );
+            }
+        }
+        for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+            if( !derivations[i].registers.empty() ) {
+                resolveRegisters( i );
+            }
+        }
+        registerIndexes.clear();
+        for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+            resolvePeripheral( i );
+        }
+    }
+};
+
+} // namespace
+
+void applyDefaults( RegisterList& registers, std::size_t first, const RegisterDefaults& defaults )
+{
+    for( std::size_t i = first; i < registers.size(); ++i ) {
+        Register& registe = registers[i];
+        const unsigned int missing = defaults.specified & ~registe.specified;
+        if( missing & RegisterSize ) {
+            registe.size = defaults.size;
+        }
+        if( missing & RegisterAccess ) {
+            registe.registerAccess = defaults.access;
+        }
+        if( missing & RegisterResetValue ) {
+            registe.resetValue = defaults.resetValue;
+        }
+        registe.specified |= missing;
+    }
+}
+
+void DerivationResolver::resolve( std::vector< Peripheral >& peripherals,
+    const std::vector< PeripheralDerivations >& derivations )
+{
+    Resolver( peripherals, derivations ).run();
+}
+
+} // namespace svd
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Peripheral.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// derivedFrom support shared by all parser backends. Parsers record which
+// elements a derived peripheral, register or field specified itself; once the
+// whole device is parsed DerivationResolver fills in the rest from the base,
+// so bases may appear after the objects derived from them. Register defaults
+// of the enclosing levels are filled in the same way.
+namespace svd {
+
+enum EPeripheralElement : unsigned int
+{
+    PeripheralName = 1 << 0,
+    PeripheralBaseAddress = 1 << 1,
+    PeripheralDescription = 1 << 2,
+    PeripheralGroupName = 1 << 3,
+    PeripheralAddressBlock = 1 << 4,
+    PeripheralRegisters = 1 << 5
+};
+
+enum ERegisterElement : unsigned int
+{
+    RegisterName = 1 << 0,
+    RegisterDescription = 1 << 1,
+    RegisterAddressOffset = 1 << 2,
+    RegisterSize = 1 << 3,
+    RegisterAccess = 1 << 4,
+    RegisterResetValue = 1 << 5,
+    RegisterFields = 1 << 6,
+    RegisterDim = 1 << 7,
+    RegisterDimIncrement = 1 << 8,
+    RegisterDimIndex = 1 << 9
+};
+
+enum EFieldElement : unsigned int
+{
+    FieldName = 1 << 0,
+    FieldDescription = 1 << 1,
+    FieldBitOffset = 1 << 2,
+    FieldBitWidth = 1 << 3,
+    FieldAccess = 1 << 4
+};
+
+// registerPropertiesGroup of a device, peripheral or cluster: size, access
+// and resetValue of the registers inside that don't give their own
+struct RegisterDefaults
+{
+    // ERegisterElement bits of the defaults that are present
+    unsigned int specified = 0;
+    unsigned int size = 0;
+    EAccess access = EAccess::Read_Write;
+    std::uint64_t resetValue = 0;
+};
+
+// Fills in registers[first..], applied from the innermost level outwards
+void applyDefaults( RegisterList& registers, std::size_t first, const RegisterDefaults& defaults );
+
+struct PendingRegister
+{
+    std::size_t registe;
+    unsigned int specified;
+};
+
+struct PendingField
+{
+    std::size_t registe;
+    std::size_t field;
+    unsigned int specified;
+};
+
+// Derived objects found while parsing one peripheral
+struct PeripheralDerivations
+{
+    unsigned int specified = 0;
+    std::vector< PendingRegister > registers;
+    std::vector< PendingField > fields;
+};
+
+struct DerivationResolver
+{
+    // derivations[i] belongs to peripherals[i]
+    static void resolve( std::vector< Peripheral >& peripherals,
+        const std::vector< PeripheralDerivations >& derivations );
+};
+
+} // namespace svd
@@ -1,19 +1,30 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 struct DeviceInfo
 {
     std::string schemaVersion;
     std::string name;
     std::string version;
-    unsigned int resetValue;
+    // <cpu><name>, e.g. CM4
+    std::string cpuName;
+    std::uint64_t resetValue = 0;
+
+    bool operator==( const DeviceInfo& other ) const
+    {
+        return schemaVersion == other.schemaVersion && name == other.name && version == other.version
+            && cpuName == other.cpuName && resetValue == other.resetValue;
+    }
 
     void printDeviceInfo() const
     {
         std::cout << "schemaVersion " << schemaVersion << std::endl
                   << "name " << name << std::endl
                   << "version " << version << std::endl
+                  << "cpu " << cpuName << std::endl
                   << "resetValue 0x" << std::hex << resetValue << std::dec << std::endl;
     }
 };
@@ -0,0 +1,378 @@
+#include "DeviceModel.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+// Model file layout: ModelFileHeader, the DeviceInfo strings, then the
+// peripheral, register, field and field layout arrays and the string arena.
+// Every section starts 8 byte aligned at the offset stored in the header and
+// holds the records exactly as they are in memory, so a section can be read
+// straight into its vector (or mapped) without decoding.
+constexpr char modelMagic[8] = { 'S', 'V', 'D', '2', 'C', 'P', 'P', 'M' };
+// Bump whenever a record or the header changes
+constexpr std::uint32_t modelFormatVersion = 4;
+constexpr std::uint32_t byteOrderMark = 0x01020304;
+
+struct ModelSection
+{
+    std::uint64_t offset = 0;
+    std::uint64_t count = 0;
+};
+
+struct ModelFileHeader
+{
+    char magic[8];
+    std::uint32_t formatVersion = modelFormatVersion;
+    std::uint32_t byteOrder = byteOrderMark;
+    std::uint32_t recordSizes[3] = { sizeof( PeripheralRecord ), sizeof( RegisterRecord ), sizeof( FieldRecord ) };
+    std::uint32_t schemaVersionLength = 0;
+    std::uint32_t nameLength = 0;
+    std::uint32_t versionLength = 0;
+    std::uint32_t cpuNameLength = 0;
+    std::uint32_t reserved = 0;
+    std::uint64_t resetValue = 0;
+    ModelSection peripherals;
+    ModelSection registers;
+    ModelSection fields;
+    ModelSection fieldLayouts;
+    ModelSection strings;
+};
+
+//Records are dumped byte for byte, so they must not contain padding
+static_assert( std::is_trivially_copyable_v< PeripheralRecord > && sizeof( PeripheralRecord ) == 52 );
+static_assert( std::is_trivially_copyable_v< RegisterRecord > && sizeof( RegisterRecord ) == 64 );
+static_assert( std::is_trivially_copyable_v< FieldRecord > && sizeof( FieldRecord ) == 28 );
+static_assert( sizeof( EAccess ) == 4 );
+static_assert( std::is_trivially_copyable_v< ModelFileHeader > && sizeof( ModelFileHeader ) == 136 );
+
+std::uint64_t alignSection( std::uint64_t offset )
+{
+    return ( offset + 7 ) & ~std::uint64_t( 7 );
+}
+
+template< typename T >
+ModelSection placeSection( std::uint64_t& end, std::size_t count )
+{
+    ModelSection section{ alignSection( end ), count };
+    end = section.offset + count * sizeof( T );
+    return section;
+}
+
+template< typename T >
+void writeSection( std::ofstream& file, const ModelSection& section, const T* data )
+{
+    static const char zeros[8] = {};
+    const auto position = static_cast< std::uint64_t >( file.tellp() );
+    file.write( zeros, static_cast< std::streamsize >( section.offset - position ) );
+    file.write( reinterpret_cast< const char* >( data ), static_cast< std::streamsize >( section.count * sizeof( T ) ) );
+}
+
+template< typename Container >
+void readSection( std::ifstream& file, std::uint64_t fileSize, const ModelSection& section, Container& out )
+{
+    using T = typename Container::value_type;
+    if( section.offset > fileSize || section.count > ( fileSize - section.offset ) / sizeof( T ) ) {
+        throw std::runtime_error( "Truncated model file" );
+    }
+    out.resize( section.count );
+    file.seekg( static_cast< std::streamoff >( section.offset ) );
+    file.read( reinterpret_cast< char* >( out.data() ), static_cast< std::streamsize >( section.count * sizeof( T ) ) );
+}
+
+} // namespace
+
+DeviceModel DeviceModel::fromPeripherals( const DeviceInfo& deviceInfo,
+    const std::vector< Peripheral >& peripherals )
+{
+    DeviceModel model;
+    model.deviceInfo = deviceInfo;
+
+    //Register lists shared by derived peripherals are stored once
+    std::unordered_map< const RegisterList*, std::uint32_t > storedLists;
+    std::size_t registerCount = 0, fieldCount = 0;
+    for( auto& peripheral : peripherals ) {
+        if( !storedLists.emplace( &peripheral.getRegisters(), 0 ).second ) {
+            continue;
+        }
+        registerCount += peripheral.getRegisters().size();
+        for( auto& registe : peripheral.getRegisters() ) {
+            fieldCount += registe.fields.size();
+        }
+    }
+    storedLists.clear();
+    model.peripherals.reserve( peripherals.size() );
+    model.registers.reserve( registerCount );
+    model.fields.reserve( fieldCount );
+
+    for( auto& peripheral : peripherals ) {
+        const RegisterList& registers = peripheral.getRegisters();
+        PeripheralRecord record;
+        record.name = model.intern( peripheral.name );
+        record.description = model.intern( peripheral.description );
+        record.groupName = model.intern( peripheral.groupName );
+        record.baseAddress = peripheral.baseAddress;
+        record.addressBlockOffset = peripheral.addressBlock.offset;
+        record.addressBlockSize = peripheral.addressBlock.size;
+        record.registerCount = static_cast< std::uint32_t >( registers.size() );
+        auto [stored, isNew] =
+            storedLists.emplace( &registers, static_cast< std::uint32_t >( model.registers.size() ) );
+        record.firstRegister = stored->second;
+        model.peripherals.push_back( record );
+        if( !isNew ) {
+            continue;
+        }
+        for( auto& registe : registers ) {
+            RegisterRecord registerRecord;
+            registerRecord.name = model.intern( registe.name );
+            registerRecord.description = model.intern( registe.description );
+            registerRecord.addressOffset = registe.addressOffset;
+            registerRecord.size = registe.size;
+            registerRecord.resetValue = registe.resetValue;
+            registerRecord.registerAccess = registe.registerAccess;
+            registerRecord.dim = registe.dim;
+            registerRecord.dimIncrement = registe.dimIncrement;
+            registerRecord.dimIndex = model.intern( registe.dimIndex );
+            registerRecord.firstField = static_cast< std::uint32_t >( model.fields.size() );
+            registerRecord.fieldCount = static_cast< std::uint32_t >( registe.fields.size() );
+            for( auto& field : registe.fields ) {
+                FieldRecord fieldRecord;
+                fieldRecord.name = model.intern( field.name );
+                fieldRecord.description = model.intern( field.description );
+                fieldRecord.bitOffset = field.bitOffset;
+                fieldRecord.bitWidth = field.bitWidth;
+                fieldRecord.fieldAccess = field.fieldAccess;
+                model.fields.push_back( fieldRecord );
+            }
+            model.registers.push_back( registerRecord );
+        }
+    }
+    model.linkDerivations( peripherals );
+    model.finalize();
+    return model;
+}
+
+void DeviceModel::linkDerivations( const std::vector< Peripheral >& source )
+{
+    //First peripheral of a name wins, like in DerivationResolver
+    std::unordered_map< std::string_view, std::uint32_t > indexOfName;
+    for( std::size_t i = 0; i < source.size(); ++i ) {
+        indexOfName.emplace( source[i].name, static_cast< std::uint32_t >( i ) );
+    }
+    for( std::size_t i = 0; i < source.size(); ++i ) {
+        if( source[i].derivedFrom.empty() ) {
+            continue;
+        }
+        auto it = indexOfName.find( source[i].derivedFrom );
+        if( it != indexOfName.end() && it->second != i ) {
+            peripherals[i].derivedFrom = it->second;
+        }
+    }
+
+    //Walk up derivedFrom as long as the register list stays the same one,
+    //the peripheral where it stops owns the class of the layout
+    for( std::size_t i = 0; i < source.size(); ++i ) {
+        std::uint32_t layout = static_cast< std::uint32_t >( i );
+        for( std::size_t steps = 0; steps < source.size(); ++steps ) {
+            const std::uint32_t base = peripherals[layout].derivedFrom;
+            if( base == noPeripheral || &source[base].getRegisters() != &source[layout].getRegisters() ) {
+                break;
+            }
+            layout = base;
+        }
+        //A derivation cycle has no root, every member keeps its own class
+        const std::uint32_t base = peripherals[layout].derivedFrom;
+        if( base != noPeripheral && &source[base].getRegisters() == &source[layout].getRegisters() ) {
+            layout = static_cast< std::uint32_t >( i );
+        }
+        peripherals[i].layout = layout;
+    }
+}
+
+std::size_t DeviceModel::memoryUsage() const
+{
+    return peripherals.capacity() * sizeof( PeripheralRecord ) + registers.capacity() * sizeof( RegisterRecord )
+        + fields.capacity() * sizeof( FieldRecord ) + fieldLayouts.capacity() * sizeof( std::uint32_t )
+        + strings.capacity() + internTable.capacity() * sizeof( StringRef );
+}
+
+StringRef DeviceModel::intern( std::string_view text )
+{
+    if( text.empty() ) {
+        return {};
+    }
+    if( ( internCount + 1 ) * 2 > internTable.size() ) {
+        growInternTable();
+    }
+    const std::size_t mask = internTable.size() - 1;
+    for( std::size_t slot = std::hash< std::string_view >()( text ) & mask;; slot = ( slot + 1 ) & mask ) {
+        StringRef& ref = internTable[slot];
+        if( ref.length == 0 ) {
+            if( strings.size() + text.size() > UINT32_MAX ) {
+                throw std::length_error( "Device model string arena exceeds 4 GiB" );
+            }
+            ref.offset = static_cast< std::uint32_t >( strings.size() );
+            ref.length = static_cast< std::uint32_t >( text.size() );
+            strings.append( text );
+            ++internCount;
+            return ref;
+        }
+        if( str( ref ) == text ) {
+            return ref;
+        }
+    }
+}
+
+void DeviceModel::growInternTable()
+{
+    std::vector< StringRef > old( internTable.empty() ? 512 : internTable.size() * 2 );
+    old.swap( internTable );
+    const std::size_t mask = internTable.size() - 1;
+    for( auto& ref : old ) {
+        if( ref.length == 0 ) {
+            continue;
+        }
+        std::size_t slot = std::hash< std::string_view >()( str( ref ) ) & mask;
+        while( internTable[slot].length != 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        internTable[slot] = ref;
+    }
+}
+
+void DeviceModel::finalize()
+{
+    internTable = {};
+    internCount = 0;
+    peripherals.shrink_to_fit();
+    registers.shrink_to_fit();
+    fields.shrink_to_fit();
+    strings.shrink_to_fit();
+}
+
+void DeviceModel::save( const std::string& path ) const
+{
+    ModelFileHeader header{};
+    std::memcpy( header.magic, modelMagic, sizeof( modelMagic ) );
+    header.resetValue = deviceInfo.resetValue;
+    header.schemaVersionLength = static_cast< std::uint32_t >( deviceInfo.schemaVersion.size() );
+    header.nameLength = static_cast< std::uint32_t >( deviceInfo.name.size() );
+    header.versionLength = static_cast< std::uint32_t >( deviceInfo.version.size() );
+    header.cpuNameLength = static_cast< std::uint32_t >( deviceInfo.cpuName.size() );
+    std::uint64_t end = sizeof( header ) + header.schemaVersionLength + header.nameLength + header.versionLength
+        + header.cpuNameLength;
+    header.peripherals = placeSection< PeripheralRecord >( end, peripherals.size() );
+    header.registers = placeSection< RegisterRecord >( end, registers.size() );
+    header.fields = placeSection< FieldRecord >( end, fields.size() );
+    header.fieldLayouts = placeSection< std::uint32_t >( end, fieldLayouts.size() );
+    header.strings = placeSection< char >( end, strings.size() );
+
+    std::ofstream file( path, std::ios::binary );
+    file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+    file << deviceInfo.schemaVersion << deviceInfo.name << deviceInfo.version << deviceInfo.cpuName;
+    writeSection( file, header.peripherals, peripherals.data() );
+    writeSection( file, header.registers, registers.data() );
+    writeSection( file, header.fields, fields.data() );
+    writeSection( file, header.fieldLayouts, fieldLayouts.data() );
+    writeSection( file, header.strings, strings.data() );
+    file.close();
+    if( !file ) {
+        throw std::runtime_error( "Failed to write model file " + path );
+    }
+}
+
+DeviceModel DeviceModel::load( const std::string& path )
+{
+    std::ifstream file( path, std::ios::binary | std::ios::ate );
+    if( !file ) {
+        throw std::runtime_error( "Couldn't open model file " + path );
+    }
+    const auto fileSize = static_cast< std::uint64_t >( file.tellg() );
+    file.seekg( 0 );
+    ModelFileHeader header{};
+    file.read( reinterpret_cast< char* >( &header ), sizeof( header ) );
+    if( !file || std::memcmp( header.magic, modelMagic, sizeof( modelMagic ) ) != 0 ) {
+        throw std::runtime_error( path + " is not a svd2cpp model file" );
+    }
+    const ModelFileHeader expected{};
+    if( header.formatVersion != modelFormatVersion || header.byteOrder != byteOrderMark
+        || std::memcmp( header.recordSizes, expected.recordSizes, sizeof( expected.recordSizes ) ) != 0 ) {
+        throw std::runtime_error( path + " was written by an incompatible svd2cpp version" );
+    }
+
+    DeviceModel model;
+    model.deviceInfo.resetValue = header.resetValue;
+    for( auto [text, length] : { std::pair{ &model.deviceInfo.schemaVersion, header.schemaVersionLength },
+             std::pair{ &model.deviceInfo.name, header.nameLength },
+             std::pair{ &model.deviceInfo.version, header.versionLength },
+             std::pair{ &model.deviceInfo.cpuName, header.cpuNameLength } } ) {
+        if( length > fileSize ) {
+            throw std::runtime_error( "Truncated model file" );
+        }
+        text->resize( length );
+        file.read( text->data(), length );
+    }
+    readSection( file, fileSize, header.peripherals, model.peripherals );
+    readSection( file, fileSize, header.registers, model.registers );
+    readSection( file, fileSize, header.fields, model.fields );
+    readSection( file, fileSize, header.fieldLayouts, model.fieldLayouts );
+    readSection( file, fileSize, header.strings, model.strings );
+    if( !file ) {
+        throw std::runtime_error( "Failed to read model file " + path );
+    }
+    model.validate();
+    return model;
+}
+
+void DeviceModel::validate() const
+{
+    //A damaged file must not make the builders index out of bounds
+    auto checkRef = [this]( StringRef ref ) {
+        if( ref.offset > strings.size() || ref.length > strings.size() - ref.offset ) {
+            throw std::runtime_error( "Corrupt model file: string out of range" );
+        }
+    };
+    auto checkAccess = []( EAccess access ) {
+        if( static_cast< std::uint32_t >( access ) > static_cast< std::uint32_t >( EAccess::Read_Write ) ) {
+            throw std::runtime_error( "Corrupt model file: unknown access" );
+        }
+    };
+    auto checkRange = []( std::uint64_t first, std::uint64_t count, std::size_t size ) {
+        if( first + count > size ) {
+            throw std::runtime_error( "Corrupt model file: index out of range" );
+        }
+    };
+    for( auto& peripheral : peripherals ) {
+        checkRef( peripheral.name );
+        checkRef( peripheral.description );
+        checkRef( peripheral.groupName );
+        checkRange( peripheral.firstRegister, peripheral.registerCount, registers.size() );
+        checkRange( peripheral.layout, 1, peripherals.size() );
+        if( peripheral.derivedFrom != noPeripheral ) {
+            checkRange( peripheral.derivedFrom, 1, peripherals.size() );
+        }
+    }
+    for( auto& registe : registers ) {
+        checkRef( registe.name );
+        checkRef( registe.description );
+        checkRef( registe.dimIndex );
+        checkAccess( registe.registerAccess );
+        checkRange( registe.firstField, registe.fieldCount, fields.size() );
+        if( registe.fieldLayout != noFieldLayout ) {
+            checkRange( registe.fieldLayout, 1, fieldLayouts.size() );
+        }
+    }
+    for( auto& field : fields ) {
+        checkRef( field.name );
+        checkRef( field.description );
+        checkAccess( field.fieldAccess );
+    }
+    for( auto layout : fieldLayouts ) {
+        checkRange( layout, 1, registers.size() );
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "DeviceInfo.hpp"
+#include "Peripheral.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compact, index based representation of a device. Peripherals, registers and
+// fields live in three contiguous arrays, children are referenced as index
+// ranges and every string is interned once into a single character arena.
+
+// Handle of a string in the DeviceModel string arena
+struct StringRef
+{
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+};
+
+// Index value of PeripheralRecord links that point nowhere
+constexpr std::uint32_t noPeripheral = UINT32_MAX;
+// RegisterRecord::fieldLayout of a register that emits its fields itself
+constexpr std::uint32_t noFieldLayout = UINT32_MAX;
+
+struct FieldRecord
+{
+    StringRef name;
+    StringRef description;
+    std::uint32_t bitOffset = 0;
+    std::uint32_t bitWidth = 0;
+    EAccess fieldAccess = EAccess::Read_Write;
+};
+
+struct RegisterRecord
+{
+    StringRef name;
+    StringRef description;
+    std::uint32_t addressOffset = 0;
+    std::uint32_t size = 0;
+    std::uint64_t resetValue = 0;
+    EAccess registerAccess = EAccess::Read_Write;
+    std::uint32_t firstField = 0;
+    std::uint32_t fieldCount = 0;
+    // Shared field layout the register reuses, see Deduplicator
+    std::uint32_t fieldLayout = noFieldLayout;
+    // <dim> array of dim registers dimIncrement bytes apart, dim is 0 otherwise
+    std::uint32_t dim = 0;
+    std::uint32_t dimIncrement = 0;
+    StringRef dimIndex;
+};
+
+struct PeripheralRecord
+{
+    StringRef name;
+    StringRef description;
+    StringRef groupName;
+    std::uint32_t baseAddress = 0;
+    std::uint32_t addressBlockOffset = 0;
+    std::uint32_t addressBlockSize = 0;
+    std::uint32_t firstRegister = 0;
+    std::uint32_t registerCount = 0;
+    // Peripheral named by derivedFrom, if it was found
+    std::uint32_t derivedFrom = noPeripheral;
+    // Peripheral whose class describes this one's registers, itself unless
+    // the register list is shared with its base
+    std::uint32_t layout = noPeripheral;
+};
+
+template< typename T >
+struct ModelRange
+{
+    const T* first = nullptr;
+    const T* last = nullptr;
+
+    inline const T* begin() const
+    {
+        return first;
+    }
+    inline const T* end() const
+    {
+        return last;
+    }
+    inline std::size_t size() const
+    {
+        return static_cast< std::size_t >( last - first );
+    }
+    inline bool empty() const
+    {
+        return first == last;
+    }
+    inline const T& operator[]( std::size_t index ) const
+    {
+        return first[index];
+    }
+};
+
+struct DeviceModel
+{
+    // Conversion from the nested parser model
+    static DeviceModel fromPeripherals( const DeviceInfo& deviceInfo, const std::vector< Peripheral >& peripherals );
+
+    inline const DeviceInfo& getDeviceInfo() const
+    {
+        return deviceInfo;
+    }
+    inline ModelRange< PeripheralRecord > getPeripherals() const
+    {
+        return { peripherals.data(), peripherals.data() + peripherals.size() };
+    }
+    inline const PeripheralRecord& peripheralAt( std::uint32_t index ) const
+    {
+        return peripherals[index];
+    }
+    inline std::uint32_t indexOf( const PeripheralRecord& peripheral ) const
+    {
+        return static_cast< std::uint32_t >( &peripheral - peripherals.data() );
+    }
+    inline bool hasOwnLayout( const PeripheralRecord& peripheral ) const
+    {
+        return peripheral.layout == indexOf( peripheral );
+    }
+    inline ModelRange< RegisterRecord > registersOf( const PeripheralRecord& peripheral ) const
+    {
+        const RegisterRecord* first = registers.data() + peripheral.firstRegister;
+        return { first, first + peripheral.registerCount };
+    }
+    inline const RegisterRecord& registerAt( std::uint32_t index ) const
+    {
+        return registers[index];
+    }
+    // Representative register of every shared field layout
+    inline ModelRange< std::uint32_t > getFieldLayouts() const
+    {
+        return { fieldLayouts.data(), fieldLayouts.data() + fieldLayouts.size() };
+    }
+    inline ModelRange< FieldRecord > fieldsOf( const RegisterRecord& registe ) const
+    {
+        const FieldRecord* first = fields.data() + registe.firstField;
+        return { first, first + registe.fieldCount };
+    }
+    inline std::string_view str( StringRef ref ) const
+    {
+        return std::string_view( strings.data() + ref.offset, ref.length );
+    }
+
+    // Bytes held by the model's arrays and string arena
+    std::size_t memoryUsage() const;
+
+    // Versioned binary image of the model, see DeviceModel.cpp for the
+    // layout. Both throw std::runtime_error on failure.
+    void save( const std::string& path ) const;
+    static DeviceModel load( const std::string& path );
+
+private:
+    friend struct Deduplicator;
+
+    StringRef intern( std::string_view text );
+    // Fills derivedFrom and layout of the peripheral records
+    void linkDerivations( const std::vector< Peripheral >& source );
+    void growInternTable();
+    // Drops the build-time intern table and trims the arrays
+    void finalize();
+    // Bounds checks every index and string handle of a loaded model
+    void validate() const;
+
+private:
+    DeviceInfo deviceInfo;
+    std::vector< PeripheralRecord > peripherals;
+    std::vector< RegisterRecord > registers;
+    std::vector< FieldRecord > fields;
+    std::vector< std::uint32_t > fieldLayouts;
+    std::string strings;
+    // Open addressing table of interned strings, empty slots have zero length
+    std::vector< StringRef > internTable;
+    std::size_t internCount = 0;
+};
@@ -0,0 +1,210 @@
+#include "DimArray.hpp"
+#include "logging.h"
+
+#include <algorithm>
+#include <charconv>
+#include <unordered_set>
+
+namespace svd {
+
+namespace {
+
+std::string_view trim( std::string_view text )
+{
+    const auto begin = text.find_first_not_of( " \t\r\n" );
+    if( begin == std::string_view::npos ) {
+        return {};
+    }
+    return text.substr( begin, text.find_last_not_of( " \t\r\n" ) - begin + 1 );
+}
+
+bool toNumber( std::string_view text, unsigned int& value )
+{
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars( text.data(), end, value );
+    return !text.empty() && ec == std::errc() && ptr == end;
+}
+
+// "[%s]" or "%s" replaced by the element name
+std::string elementName( std::string_view name, std::string_view element )
+{
+    std::string result( name );
+    for( std::string_view placeholder : { "[%s]", "%s" } ) {
+        const auto at = result.find( placeholder );
+        if( at != std::string::npos ) {
+            return result.replace( at, placeholder.size(), element );
+        }
+    }
+    return result + std::string( element );
+}
+
+// A register's derivedFrom, or the register part of a field's, that names a
+// register of the same cluster gets the cluster's prefix, so siblings are
+// found before registers of the peripheral with the same name
+void qualifySiblingPath( std::string& path,
+    bool fieldPath,
+    const std::unordered_set< std::string >& siblings,
+    const std::string& prefix )
+{
+    const auto dot = fieldPath ? path.rfind( '.' ) : std::string::npos;
+    if( path.empty() || ( fieldPath && dot == std::string::npos ) ) {
+        return;
+    }
+    //Registers of nested clusters are already flattened to "CLUSTER_REG"
+    std::string registerPath = path.substr( 0, dot );
+    std::replace( registerPath.begin(), registerPath.end(), '.', '_' );
+    if( siblings.count( registerPath ) > 0 ) {
+        path = prefix + registerPath + ( dot == std::string::npos ? "" : path.substr( dot ) );
+    }
+}
+
+void qualifySiblings( Register& registe, const std::unordered_set< std::string >& siblings, const std::string& prefix )
+{
+    qualifySiblingPath( registe.derivedFrom, false, siblings, prefix );
+    for( auto& field : registe.fields ) {
+        qualifySiblingPath( field.derivedFrom, true, siblings, prefix );
+    }
+}
+
+} // namespace
+
+std::string dimBaseName( std::string_view name )
+{
+    return elementName( name, "" );
+}
+
+std::vector< std::string > dimIndices( std::string_view dimIndex, unsigned int dim )
+{
+    std::vector< std::string > indices;
+    dimIndex = trim( dimIndex );
+    const auto dash = dimIndex.find( '-' );
+    unsigned int from = 0, to = 0;
+    if( dimIndex.find( ',' ) != std::string_view::npos ) {
+        for( std::size_t begin = 0; begin <= dimIndex.size(); ) {
+            const auto comma = std::min( dimIndex.find( ',', begin ), dimIndex.size() );
+            indices.emplace_back( trim( dimIndex.substr( begin, comma - begin ) ) );
+            begin = comma + 1;
+        }
+    }
+    else if( dash != std::string_view::npos && toNumber( trim( dimIndex.substr( 0, dash ) ), from )
+        && toNumber( trim( dimIndex.substr( dash + 1 ) ), to ) && from <= to ) {
+        for( unsigned int index = from; index <= to && indices.size() <= dim; ++index ) {
+            indices.push_back( std::to_string( index ) );
+        }
+    }
+    else if( dimIndex.size() == 3 && dash == 1 && dimIndex[0] <= dimIndex[2] ) {
+        for( char letter = dimIndex[0]; letter <= dimIndex[2]; ++letter ) {
+            indices.emplace_back( 1, letter );
+        }
+    }
+    else if( !dimIndex.empty() ) {
+        indices.emplace_back( dimIndex );
+    }
+
+    if( indices.size() != dim ) {
+        if( !dimIndex.empty() ) {
+            logging::getLogger( "parser" ).warn( "Wrong dimIndex: {}", dimIndex );
+        }
+        indices.clear();
+        for( unsigned int index = 0; index < dim; ++index ) {
+            indices.push_back( std::to_string( index ) );
+        }
+    }
+    return indices;
+}
+
+unsigned int dimFirstIndex( std::string_view dimIndex, unsigned int dim )
+{
+    if( trim( dimIndex ).empty() ) {
+        return 0;
+    }
+    const std::vector< std::string > indices = dimIndices( dimIndex, dim );
+    unsigned int first = 0;
+    if( indices.empty() || !toNumber( indices[0], first ) ) {
+        return 0;
+    }
+    for( std::size_t i = 1; i < indices.size(); ++i ) {
+        unsigned int number = 0;
+        if( !toNumber( indices[i], number ) || number != first + i ) {
+            return 0;
+        }
+    }
+    return first;
+}
+
+void flattenCluster( const Cluster& cluster,
+    RegisterList& registers,
+    std::size_t first,
+    PeripheralDerivations& derivations )
+{
+    const std::size_t count = registers.size() - first;
+    applyDefaults( registers, first, cluster.defaults );
+    bool unroll = false;
+    std::unordered_set< std::string > siblings;
+    for( std::size_t i = first; i < registers.size(); ++i ) {
+        unroll = unroll || ( cluster.dim > 0 && registers[i].dim > 0 );
+        siblings.insert( registers[i].name );
+    }
+    if( !unroll ) {
+        const std::string prefix = dimBaseName( cluster.name ) + "_";
+        for( std::size_t i = first; i < registers.size(); ++i ) {
+            Register& registe = registers[i];
+            registe.name.insert( 0, prefix );
+            qualifySiblings( registe, siblings, prefix );
+            registe.addressOffset += cluster.addressOffset;
+            if( cluster.dim > 0 ) {
+                registe.dim = cluster.dim;
+                registe.dimIncrement = cluster.dimIncrement;
+                registe.dimIndex = cluster.dimIndex;
+            }
+        }
+        //The cluster's dim wins over the one of a derived register's base
+        for( auto& pending : derivations.registers ) {
+            if( cluster.dim > 0 && pending.registe >= first ) {
+                pending.specified |= RegisterDim | RegisterDimIncrement | RegisterDimIndex;
+            }
+        }
+        return;
+    }
+
+    //Element 0 reuses the parsed registers, the other elements are appended
+    const std::vector< std::string > indices = dimIndices( cluster.dimIndex, cluster.dim );
+    const RegisterList parsed( registers.begin() + static_cast< std::ptrdiff_t >( first ), registers.end() );
+    const std::size_t pendingRegisters = derivations.registers.size();
+    const std::size_t pendingFields = derivations.fields.size();
+    for( std::size_t element = 0; element < indices.size(); ++element ) {
+        const std::size_t target = element == 0 ? first : registers.size();
+        const std::string prefix = elementName( cluster.name, indices[element] ) + "_";
+        for( std::size_t i = 0; i < count; ++i ) {
+            Register registe = parsed[i];
+            registe.name.insert( 0, prefix );
+            qualifySiblings( registe, siblings, prefix );
+            registe.addressOffset += cluster.addressOffset + static_cast< unsigned int >( element ) * cluster.dimIncrement;
+            if( element == 0 ) {
+                registers[first + i] = std::move( registe );
+            }
+            else {
+                registers.push_back( std::move( registe ) );
+            }
+        }
+        if( element == 0 ) {
+            continue;
+        }
+        for( std::size_t i = 0; i < pendingRegisters; ++i ) {
+            PendingRegister pending = derivations.registers[i];
+            if( pending.registe >= first ) {
+                pending.registe += target - first;
+                derivations.registers.push_back( pending );
+            }
+        }
+        for( std::size_t i = 0; i < pendingFields; ++i ) {
+            PendingField pending = derivations.fields[i];
+            if( pending.registe >= first ) {
+                pending.registe += target - first;
+                derivations.fields.push_back( pending );
+            }
+        }
+    }
+}
+
+} // namespace svd
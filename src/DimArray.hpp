@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Derivation.hpp"
+#include "Peripheral.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// <dim> arrays shared by all parser backends. A register array stays a single
+// register in the model and is emitted as one class template indexed by the
+// element number. Clusters are flattened into the peripheral's register list.
+namespace svd {
+
+struct Cluster
+{
+    std::string name;
+    unsigned int addressOffset = 0;
+    RegisterDefaults defaults;
+    unsigned int dim = 0;
+    unsigned int dimIncrement = 0;
+    std::string dimIndex;
+};
+
+// Name without its "[%s]" or "%s" placeholder
+std::string dimBaseName( std::string_view name );
+// Element names listed by dimIndex ("0-3", "A-D" or "a,b,c"), "0".."dim-1"
+// when it is empty or doesn't list dim elements
+std::vector< std::string > dimIndices( std::string_view dimIndex, unsigned int dim );
+// First element number if the elements are consecutive numbers, otherwise
+// elements are counted from 0
+unsigned int dimFirstIndex( std::string_view dimIndex, unsigned int dim );
+
+// registers[first..] were parsed from the cluster's children. Their names get
+// the cluster's name as prefix, their offsets the cluster's offset, the
+// cluster's register defaults and, for a cluster array, they become
+// register arrays of the cluster's dim. derivedFrom naming a register of the
+// cluster is renamed along with it. Arrays can't be nested, so a cluster
+// array holding register arrays is unrolled into one copy per element
+// instead, along with the copies' derivations.
+void flattenCluster( const Cluster& cluster,
+    RegisterList& registers,
+    std::size_t first,
+    PeripheralDerivations& derivations );
+
+} // namespace svd
@@ -1,12 +1,46 @@
 #include "FileBuilder.hpp"
 #include "Builders.hpp"
+#include "WorkerPool.hpp"
 
-FileBuilder::FileBuilder(const cxxopts::ParseResult& results_,
-                         const DeviceInfo& deviceInfo_,
-                         const std::vector< Peripheral >& peripherals_ )
+#include <algorithm>
+#include <unordered_map>
+
+std::vector< const PeripheralRecord* > emissionOrder( const DeviceModel& model )
+{
+    //Derived peripherals are aliases of their base's class, so one whose base
+    //comes later in the file waits until that class has been emitted
+    std::vector< const PeripheralRecord* > order;
+    std::unordered_multimap< std::uint32_t, const PeripheralRecord* > waiting;
+    for( auto& peripheral : model.getPeripherals() ) {
+        if( peripheral.layout > model.indexOf( peripheral ) ) {
+            waiting.emplace( peripheral.layout, &peripheral );
+            continue;
+        }
+        order.push_back( &peripheral );
+        auto [first, last] = waiting.equal_range( model.indexOf( peripheral ) );
+        const std::size_t aliases = order.size();
+        for( auto it = first; it != last; ++it ) {
+            order.push_back( it->second );
+        }
+        std::sort( order.begin() + aliases, order.end() );
+    }
+    return order;
+}
+
+EmitOptions emitOptions( const cxxopts::ParseResult& results )
+{
+    EmitOptions emit;
+    emit.overlay = results.count( "overlay" ) != 0;
+    emit.lean = results.count( "lean" ) != 0;
+    if( results.count( "atomic" ) ) {
+        emit.atomic = AtomicPolicies( results["atomic"].as< std::vector< std::string > >() );
+    }
+    return emit;
+}
+
+FileBuilder::FileBuilder(const cxxopts::ParseResult& results_, const DeviceModel& model_ )
     : results( results_ )
-    , deviceInfo( deviceInfo_ )
-    , peripherals( peripherals_ )
+    , model( model_ )
 {
 }
 
@@ -14,21 +48,58 @@ void FileBuilder::setupBuilders()
 {
     builders.push_back(std::make_unique<NSBeginBuilder>());
     builders.push_back( std::make_unique< FieldDefineBuilder >() );
-    for( auto& peripheral : peripherals ) {
-        builders.push_back( std::make_unique< PeripheralBuilder >( peripheral ) );
+    for( std::uint32_t layout = 0; layout < model.getFieldLayouts().size(); ++layout ) {
+        builders.push_back( std::make_unique< FieldLayoutBuilder >( model, layout ) );
+    }
+    emit = emitOptions( results );
+    builderPeripherals.assign( builders.size(), noPeripheral );
+    for( auto peripheral : emissionOrder( model ) ) {
+        if( cache ) {
+            builders.push_back( std::make_unique< CachedPeripheralBuilder >( *cache, model.indexOf( *peripheral ) ) );
+        }
+        else {
+            builders.push_back( std::make_unique< PeripheralBuilder >( model, *peripheral, emit ) );
+        }
+        builderPeripherals.push_back( model.indexOf( *peripheral ) );
     }
     builders.push_back( std::make_unique< FunctionsBuilder >() );
     builders.push_back( std::make_unique<NSEnduilder>());
+    builderPeripherals.resize( builders.size(), noPeripheral );
 }
 
-void FileBuilder::build()
+void FileBuilder::build( unsigned int jobs )
 {
-    for( auto& builder : builders ) {
-        builder->build( outputStream );
+    const WorkerPool pool( jobs );
+    peripheralBytes.assign( model.getPeripherals().size(), 0 );
+    auto countBytes = [&]( std::size_t index, std::size_t bytes ) {
+        if( builderPeripherals[index] != noPeripheral ) {
+            peripheralBytes[builderPeripherals[index]] = bytes;
+        }
+    };
+    if( pool.getJobs() <= 1 ) {
+        for( std::size_t index = 0; index < builders.size(); ++index ) {
+            const std::size_t before = output.size();
+            builders[index]->build( output );
+            countBytes( index, output.size() - before );
+        }
+        return;
+    }
+    std::vector< OutputSink > parts( builders.size() );
+    pool.run( builders.size(), [&]( std::size_t index ) { builders[index]->build( parts[index] ); } );
+    std::size_t size = output.size();
+    for( std::size_t index = 0; index < parts.size(); ++index ) {
+        size += parts[index].size();
+        countBytes( index, parts[index].size() );
+    }
+    output.reserve( size );
+    for( auto& part : parts ) {
+        output += part;
+        //Free each part once copied, so the header isn't held twice
+        OutputSink().swap( part );
     }
 }
 
-const std::stringstream& FileBuilder::getStream() const
+OutputSink FileBuilder::takeOutput()
 {
-    return outputStream;
+    return std::move( output );
 }
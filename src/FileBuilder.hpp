@@ -1,28 +1,52 @@
 #pragma once
 
-#include "DeviceInfo.hpp"
+#include "Builders.hpp"
+#include "DeviceModel.hpp"
 #include "IBuilder.hpp"
-#include "Peripheral.hpp"
+#include "PeripheralCache.hpp"
 
 #include <cxxopts.hpp>
 
 #include <memory>
-#include <sstream>
 #include <vector>
 
+// Peripherals in document order, except that aliases never precede the class
+// they refer to
+std::vector< const PeripheralRecord* > emissionOrder( const DeviceModel& model );
+
+EmitOptions emitOptions( const cxxopts::ParseResult& results );
+
 struct FileBuilder
 {
-    FileBuilder(const cxxopts::ParseResult& results_,
-                const DeviceInfo& deviceInfo_,
-                const std::vector< Peripheral >& peripherals_ );
+    FileBuilder(const cxxopts::ParseResult& results_, const DeviceModel& model_ );
+    // Peripherals are copied from cache, updated for the model, instead of
+    // being emitted. Call before setupBuilders.
+    inline void useCache( const PeripheralCache& cache_ )
+    {
+        cache = &cache_;
+    }
     void setupBuilders();
-    void build();
-    const std::stringstream& getStream() const;
+    // With more than one job every builder renders into its own buffer on a
+    // WorkerPool and the buffers are joined in order, so the output is the
+    // same as with one job
+    void build( unsigned int jobs = 1 );
+    // Hands the finished header over without copying it
+    OutputSink takeOutput();
+    // Output bytes of every peripheral's class or alias, by model index
+    inline const std::vector< std::size_t >& getPeripheralBytes() const
+    {
+        return peripheralBytes;
+    }
 
 private:
     const cxxopts::ParseResult& results;
-    const DeviceInfo& deviceInfo;
-    const std::vector< Peripheral >& peripherals;
+    const DeviceModel& model;
+    // Referenced by the PeripheralBuilders
+    EmitOptions emit;
+    const PeripheralCache* cache = nullptr;
     std::vector< std::unique_ptr< IBuilder > > builders;
-    std::stringstream outputStream;
+    // Model index of the peripheral each builder emits, noPeripheral for others
+    std::vector< std::uint32_t > builderPeripherals;
+    std::vector< std::size_t > peripheralBytes;
+    OutputSink output;
 };
@@ -0,0 +1,281 @@
+#include "Generator.hpp"
+#include "FileBuilder.hpp"
+#include "RegenCache.hpp"
+#include "Runtime.hpp"
+#include "SplitFileBuilder.hpp"
+#include "StreamParser.hpp"
+#include "XmlParser.hpp"
+#include "logging.h"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs( Clock::time_point since )
+{
+    return std::chrono::duration< double, std::milli >( Clock::now() - since ).count();
+}
+
+std::unique_ptr< IParser > makeParser( const cxxopts::ParseResult& options,
+    const std::string& inputFile,
+    unsigned int jobs )
+{
+    const std::string backend = options.count( "parser" ) ? options["parser"].as< std::string >() : "dom";
+    using Patterns = std::vector< std::string >;
+    svd::PeripheralFilter filter( options.count( "only" ) ? options["only"].as< Patterns >() : Patterns(),
+        options.count( "exclude" ) ? options["exclude"].as< Patterns >() : Patterns() );
+    if( backend == "dom" ) {
+        return std::make_unique< XmlParser >( inputFile, jobs, std::move( filter ) );
+    }
+    if( backend == "stream" ) {
+        return std::make_unique< StreamParser >( inputFile, std::move( filter ) );
+    }
+    throw std::invalid_argument( "Unknown parser backend " + backend );
+}
+
+std::optional< ESplitMode > splitMode( const cxxopts::ParseResult& options )
+{
+    if( !options.count( "split" ) ) {
+        return std::nullopt;
+    }
+    const std::string mode = options["split"].as< std::string >();
+    if( mode == "peripheral" ) {
+        return ESplitMode::Peripheral;
+    }
+    if( mode == "group" ) {
+        return ESplitMode::Group;
+    }
+    throw std::invalid_argument( "Unknown split mode " + mode );
+}
+
+// In split mode outputFile names a directory
+void writeOutputs( const std::string& outputFile,
+    bool split,
+    const std::vector< GeneratedFile >& files,
+    GenerationResult& result )
+{
+    if( !split ) {
+        if( !writeIfChanged( outputFile, files.front().content ) ) {
+            result.status = EGenerationStatus::WriteError;
+            result.message = "Failed to write " + outputFile;
+        }
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories( outputFile, ec );
+    for( auto& file : files ) {
+        if( !writeIfChanged( std::filesystem::path( outputFile ) / file.name, file.content ) ) {
+            result.status = EGenerationStatus::WriteError;
+            result.message = "Failed to write " + file.name + " to " + outputFile;
+            return;
+        }
+    }
+}
+
+// RegBase.h goes where the headers including it are. Batch runs without
+// split share one output directory, BatchRunner writes it there once.
+void writeRuntime( const cxxopts::ParseResult& options,
+    const std::string& outputFile,
+    bool split,
+    GenerationResult& result )
+{
+    if( options.count( "no-runtime" ) || ( options.count( "batch" ) && !split ) || !result.ok() ) {
+        return;
+    }
+    const std::filesystem::path directory =
+        split ? std::filesystem::path( outputFile ) : std::filesystem::path( outputFile ).parent_path();
+    if( !runtime::writeRegBase( directory ) ) {
+        result.status = EGenerationStatus::WriteError;
+        result.message = "Failed to write " + std::string( runtime::regBaseName ) + " to " + directory.string();
+    }
+}
+
+bool wantsStats( const cxxopts::ParseResult& options )
+{
+    return options.count( "stats" ) || options.count( "stats-json" );
+}
+
+// Per-peripheral sizes of the model, peripheralBytes is indexed like the
+// model's peripherals
+void collectPeripherals( const DeviceModel& model,
+    const std::vector< std::size_t >& peripheralBytes,
+    GenerationStats& stats )
+{
+    for( auto& peripheral : model.getPeripherals() ) {
+        PeripheralStats entry;
+        entry.name = std::string( model.str( peripheral.name ) );
+        entry.registers = peripheral.registerCount;
+        for( auto& registe : model.registersOf( peripheral ) ) {
+            entry.fields += registe.fieldCount;
+        }
+        const std::uint32_t index = model.indexOf( peripheral );
+        entry.outputBytes = index < peripheralBytes.size() ? peripheralBytes[index] : 0;
+        stats.peripherals.push_back( std::move( entry ) );
+    }
+}
+
+// Logs the stats and writes them as JSON to --stats-json
+void reportStats( const cxxopts::ParseResult& options,
+    GenerationStats stats,
+    std::uint64_t allocationsAtStart,
+    GenerationResult& result )
+{
+    stats.peakRssKiB = peakRssKiB();
+    stats.allocations = allocationCount() - allocationsAtStart;
+    stats.log( logging::getLogger( "stats" ) );
+    if( options.count( "stats-json" ) && result.ok() ) {
+        const std::string path = options["stats-json"].as< std::string >();
+        if( !writeIfChanged( path, stats.toJson() ) ) {
+            result.status = EGenerationStatus::WriteError;
+            result.message = "Failed to write " + path;
+        }
+    }
+    result.stats = std::move( stats );
+}
+
+} // namespace
+
+Generator::Generator( const cxxopts::ParseResult& options_, unsigned int jobs_, PeripheralCache* peripheralCache_ )
+    : options( options_ )
+    , jobs( jobs_ )
+    , peripheralCache( peripheralCache_ )
+{
+}
+
+GenerationResult Generator::run( const std::string& inputFile, const std::string& outputFile ) const
+{
+    GenerationResult result;
+    const std::uint64_t allocationsAtStart = allocationCount();
+    GenerationStats stats;
+    stats.input = inputFile;
+    try {
+        const auto split = splitMode( options );
+        const RegenCache cache( options );
+        auto start = Clock::now();
+        std::optional< std::string > key;
+        if( cache.enabled() && ( key = cache.keyOf( inputFile ) ) ) {
+            //A model dump needs the parsed model, so it never restores from the cache
+            auto files = options.count( "dump-model" ) ? std::nullopt : cache.load( *key );
+            if( files ) {
+                result.cached = true;
+                result.parseMs = elapsedMs( start );
+                start = Clock::now();
+                const PhaseTimer writeTimer;
+                writeOutputs( outputFile, split.has_value(), *files, result );
+                writeRuntime( options, outputFile, split.has_value(), result );
+                result.writeMs = elapsedMs( start );
+                if( wantsStats( options ) ) {
+                    stats.cached = true;
+                    stats.write = writeTimer.stop();
+                    for( auto& file : *files ) {
+                        stats.outputBytes += file.content.size();
+                    }
+                    reportStats( options, std::move( stats ), allocationsAtStart, result );
+                }
+                return result;
+            }
+        }
+
+        std::optional< DeviceModel > model;
+        if( options.count( "load-model" ) ) {
+            //inputFile is a model written by --dump-model, no XML involved
+            try {
+                model = measurePhase( stats.parser.load, [&] { return DeviceModel::load( inputFile ); } );
+            }
+            catch( const std::exception& ex ) {
+                result.status = EGenerationStatus::ReadError;
+                result.message = ex.what();
+                return result;
+            }
+        }
+        else {
+            auto parser = makeParser( options, inputFile, jobs );
+            auto err = parser->isError();
+            if( !err ) {
+                parser->parseXml();
+                //The streaming backend only finds syntax errors while parsing
+                err = parser->isError();
+            }
+            if( err ) {
+                result.status = EGenerationStatus::ReadError;
+                result.message = "There was an error while reading " + inputFile + ":\n" + *err;
+                return result;
+            }
+            stats.parser = parser->getPhases();
+            //Move to the compact model and free the parser's before emitting
+            model = DeviceModel::fromPeripherals( parser->getDeviceInfo(), parser->getPeripherals() );
+        }
+        if( options.count( "dump-model" ) ) {
+            model->save( options["dump-model"].as< std::string >() );
+        }
+        result.parseMs = elapsedMs( start );
+        if( outputFile.empty() ) {
+            if( wantsStats( options ) ) {
+                collectPeripherals( *model, {}, stats );
+                reportStats( options, std::move( stats ), allocationsAtStart, result );
+            }
+            return result;
+        }
+
+        start = Clock::now();
+        const PhaseTimer emitTimer;
+        std::vector< std::size_t > peripheralBytes;
+        if( options.count( "dedup" ) ) {
+            result.dedup = Deduplicator::run( *model, emitOptions( options ).atomic );
+        }
+        if( peripheralCache ) {
+            peripheralCache->update( *model, emitOptions( options ) );
+        }
+        std::vector< GeneratedFile > files;
+        if( split ) {
+            SplitFileBuilder splitBuilder( *model, *split, emitOptions( options ), peripheralCache );
+            splitBuilder.build( jobs );
+            peripheralBytes = splitBuilder.getPeripheralBytes();
+            for( auto& file : splitBuilder.takeFiles() ) {
+                file.content += '\n';
+                files.push_back( { std::move( file.name ), std::move( file.content ) } );
+            }
+        }
+        else {
+            FileBuilder classBuilder( options, *model );
+            if( peripheralCache ) {
+                classBuilder.useCache( *peripheralCache );
+            }
+            classBuilder.setupBuilders();
+            classBuilder.build( jobs );
+            peripheralBytes = classBuilder.getPeripheralBytes();
+            OutputSink header = classBuilder.takeOutput();
+            header += '\n';
+            files.push_back( { std::filesystem::path( outputFile ).filename().string(), std::move( header ) } );
+        }
+        result.emitMs = elapsedMs( start );
+        stats.emit = emitTimer.stop();
+
+        start = Clock::now();
+        const PhaseTimer writeTimer;
+        writeOutputs( outputFile, split.has_value(), files, result );
+        writeRuntime( options, outputFile, split.has_value(), result );
+        result.writeMs = elapsedMs( start );
+        stats.write = writeTimer.stop();
+        if( key && result.ok() ) {
+            cache.store( *key, files );
+        }
+        if( wantsStats( options ) ) {
+            for( auto& file : files ) {
+                stats.outputBytes += file.content.size();
+            }
+            collectPeripherals( *model, peripheralBytes, stats );
+            reportStats( options, std::move( stats ), allocationsAtStart, result );
+        }
+    }
+    catch( const std::exception& ex ) {
+        result.status = EGenerationStatus::Failed;
+        result.message = ex.what();
+    }
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Deduplication.hpp"
+#include "PeripheralCache.hpp"
+#include "Stats.hpp"
+
+#include <cxxopts.hpp>
+
+#include <optional>
+#include <string>
+
+enum class EGenerationStatus
+{
+    Ok,
+    ReadError,
+    WriteError,
+    Failed
+};
+
+struct GenerationResult
+{
+    EGenerationStatus status = EGenerationStatus::Ok;
+    std::string message;
+    double parseMs = 0;
+    double emitMs = 0;
+    double writeMs = 0;
+    // Set when --dedup was given
+    std::optional< DedupStats > dedup;
+    // Outputs came from the regeneration cache, nothing was parsed
+    bool cached = false;
+    // Set when --stats or --stats-json was given
+    std::optional< GenerationStats > stats;
+    inline bool ok() const
+    {
+        return status == EGenerationStatus::Ok;
+    }
+    inline double totalMs() const
+    {
+        return parseMs + emitMs + writeMs;
+    }
+};
+
+// Runs XmlParser + FileBuilder for one device and writes the header.
+// Never throws, every failure is reported through GenerationResult.
+struct Generator
+{
+    // jobs is the number of threads parsing and emitting, 0 means one per core.
+    // With a cache only peripherals that changed since its last run are
+    // emitted, see Watcher.
+    Generator( const cxxopts::ParseResult& options_, unsigned int jobs_ = 1, PeripheralCache* peripheralCache_ = nullptr );
+    GenerationResult run( const std::string& inputFile, const std::string& outputFile ) const;
+
+private:
+    const cxxopts::ParseResult& options;
+    const unsigned int jobs;
+    PeripheralCache* const peripheralCache;
+};
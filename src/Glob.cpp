@@ -0,0 +1,74 @@
+#include "Glob.hpp"
+
+namespace {
+
+// Matches a "[...]" class starting at pattern[pos]; on success advances pos past ']'
+bool matchClass( std::string_view pattern, std::size_t& pos, char c )
+{
+    std::size_t i = pos + 1;
+    const bool negate = i < pattern.size() && ( pattern[i] == '!' || pattern[i] == '^' );
+    if( negate ) {
+        ++i;
+    }
+    bool matched = false;
+    bool first = true;
+    for( ; i < pattern.size() && ( first || pattern[i] != ']' ); ++i, first = false ) {
+        if( i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']' ) {
+            matched |= pattern[i] <= c && c <= pattern[i + 2];
+            i += 2;
+        }
+        else {
+            matched |= pattern[i] == c;
+        }
+    }
+    if( i >= pattern.size() ) {
+        // Unterminated class, treat '[' literally
+        pos = pos + 1;
+        return c == '[';
+    }
+    pos = i + 1;
+    return matched != negate;
+}
+
+} // namespace
+
+bool globMatch( std::string_view pattern, std::string_view text )
+{
+    std::size_t p = 0, t = 0;
+    std::size_t starP = std::string_view::npos, starT = 0;
+    while( t < text.size() ) {
+        if( p < pattern.size() && pattern[p] == '*' ) {
+            starP = p++;
+            starT = t;
+            continue;
+        }
+        if( p < pattern.size() ) {
+            std::size_t next = p;
+            if( pattern[p] == '[' && matchClass( pattern, next, text[t] ) ) {
+                p = next;
+                ++t;
+                continue;
+            }
+            if( pattern[p] == '?' || ( pattern[p] != '[' && pattern[p] == text[t] ) ) {
+                ++p;
+                ++t;
+                continue;
+            }
+        }
+        if( starP == std::string_view::npos ) {
+            return false;
+        }
+        // Backtrack: let the last '*' swallow one more character
+        p = starP + 1;
+        t = ++starT;
+    }
+    while( p < pattern.size() && pattern[p] == '*' ) {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+bool hasGlobChars( std::string_view text )
+{
+    return text.find_first_of( "*?[" ) != std::string_view::npos;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string_view>
+
+// Shell-style wildcard matching: '*' matches any run of characters, '?' matches
+// one character and "[abc]"/"[a-z]"/"[!abc]" match a character class.
+bool globMatch( std::string_view pattern, std::string_view text );
+
+// True if the string contains any wildcard character understood by globMatch.
+bool hasGlobChars( std::string_view text );
@@ -1,9 +1,13 @@
 #pragma once
 
-#include <sstream>
+#include <string>
+
+// Append-only output of the builders. It is written to the file in one piece
+// and moved, never copied, on the way there.
+using OutputSink = std::string;
 
 struct IBuilder
 {
-    virtual void build( std::stringstream& ) const = 0;
+    virtual void build( OutputSink& ) const = 0;
     virtual ~IBuilder() = default;
 };
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "DeviceInfo.hpp"
+#include "Peripheral.hpp"
+#include "Stats.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct IParser
+{
+    virtual std::optional< std::string > isError() const = 0;
+    virtual void parseXml() = 0;
+    virtual const DeviceInfo& getDeviceInfo() const = 0;
+    virtual const std::vector< Peripheral >& getPeripherals() const = 0;
+    virtual const ParsePhases& getPhases() const = 0;
+    virtual ~IParser() = default;
+};
@@ -0,0 +1,372 @@
+#include "InputFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#ifdef SVD2CPP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SVD2CPP_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace input {
+
+namespace {
+
+constexpr std::size_t chunkSize = 64 * 1024;
+
+std::string lowercase( std::string text )
+{
+    std::transform( text.begin(), text.end(), text.begin(), []( unsigned char c ) { return std::tolower( c ); } );
+    return text;
+}
+
+bool endsWith( std::string_view text, std::string_view suffix )
+{
+    return text.size() >= suffix.size() && text.substr( text.size() - suffix.size() ) == suffix;
+}
+
+// Position of the ':' between archive and member, npos for other inputs
+std::size_t memberSeparator( const std::string& inputFile )
+{
+    const std::string lower = lowercase( inputFile );
+    for( std::string_view archive : { ".pack:", ".zip:" } ) {
+        const auto at = lower.find( archive );
+        if( at != std::string::npos ) {
+            return at + archive.size() - 1;
+        }
+    }
+    return std::string::npos;
+}
+
+bool isArchive( const std::string& inputFile )
+{
+    const std::string lower = lowercase( inputFile );
+    return memberSeparator( inputFile ) != std::string::npos || endsWith( lower, ".pack" )
+        || endsWith( lower, ".zip" );
+}
+
+std::ifstream openInput( const fs::path& path )
+{
+    std::ifstream file( path, std::ios::binary );
+    if( !file ) {
+        throw std::runtime_error( "Couldn't open " + path.string() );
+    }
+    return file;
+}
+
+std::string readPlain( const fs::path& path )
+{
+    std::ifstream file = openInput( path );
+    file.seekg( 0, std::ios::end );
+    std::string content( static_cast< std::size_t >( file.tellg() ), '\0' );
+    file.seekg( 0 );
+    file.read( content.data(), static_cast< std::streamsize >( content.size() ) );
+    if( !file ) {
+        throw std::runtime_error( "Couldn't read " + path.string() );
+    }
+    return content;
+}
+
+#ifdef SVD2CPP_HAVE_ZLIB
+// windowBits selects the format: 16 + MAX_WBITS gzip, -MAX_WBITS raw deflate.
+// next() refills the input, returns false at its end.
+template< typename Next >
+std::string inflateStream( int windowBits, Next&& next, std::size_t sizeHint, const std::string& name )
+{
+    z_stream stream{};
+    if( inflateInit2( &stream, windowBits ) != Z_OK ) {
+        throw std::runtime_error( "Couldn't start decompressing " + name );
+    }
+    std::string content;
+    content.reserve( sizeHint );
+    std::vector< char > in;
+    std::array< char, chunkSize > out;
+    bool more = true;
+    auto refill = [&] {
+        if( stream.avail_in == 0 && more ) {
+            more = next( in );
+            stream.next_in = reinterpret_cast< Bytef* >( in.data() );
+            stream.avail_in = static_cast< uInt >( in.size() );
+        }
+    };
+    int status = Z_OK;
+    for( ;; ) {
+        refill();
+        stream.next_out = reinterpret_cast< Bytef* >( out.data() );
+        stream.avail_out = static_cast< uInt >( out.size() );
+        status = inflate( &stream, Z_NO_FLUSH );
+        if( status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR ) {
+            inflateEnd( &stream );
+            throw std::runtime_error( "Corrupt compressed data in " + name );
+        }
+        content.append( out.data(), out.size() - stream.avail_out );
+        if( status == Z_STREAM_END ) {
+            //A gzip file may hold several members one after the other
+            refill();
+            if( windowBits < 0 || stream.avail_in == 0 ) {
+                break;
+            }
+            inflateReset( &stream );
+        }
+        else if( stream.avail_in == 0 && !more && stream.avail_out != 0 ) {
+            break;
+        }
+    }
+    inflateEnd( &stream );
+    if( status != Z_STREAM_END ) {
+        throw std::runtime_error( "Truncated compressed data in " + name );
+    }
+    return content;
+}
+#endif
+
+// Chunks of the file for the decompressors
+struct FileChunks
+{
+    std::ifstream file;
+    // Bytes left to hand out
+    std::uint64_t left;
+
+    bool operator()( std::vector< char >& chunk )
+    {
+        chunk.resize( static_cast< std::size_t >( std::min< std::uint64_t >( chunkSize, left ) ) );
+        file.read( chunk.data(), static_cast< std::streamsize >( chunk.size() ) );
+        chunk.resize( static_cast< std::size_t >( file.gcount() ) );
+        left -= chunk.size();
+        return left > 0 && !chunk.empty();
+    }
+};
+
+std::string readGzip( const fs::path& path )
+{
+#ifdef SVD2CPP_HAVE_ZLIB
+    std::error_code ec;
+    const std::uint64_t size = fs::file_size( path, ec );
+    return inflateStream( 16 + MAX_WBITS, FileChunks{ openInput( path ), ec ? UINT64_MAX : size },
+        static_cast< std::size_t >( size ) * 8, path.string() );
+#else
+    throw std::runtime_error( "svd2cpp was built without zlib, can't read " + path.string() );
+#endif
+}
+
+std::string readXz( const fs::path& path )
+{
+#ifdef SVD2CPP_HAVE_LZMA
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if( lzma_stream_decoder( &stream, UINT64_MAX, LZMA_CONCATENATED ) != LZMA_OK ) {
+        throw std::runtime_error( "Couldn't start decompressing " + path.string() );
+    }
+    FileChunks chunks{ openInput( path ), UINT64_MAX };
+    std::vector< char > in;
+    std::array< char, chunkSize > out;
+    std::string content;
+    lzma_ret status = LZMA_OK;
+    lzma_action action = LZMA_RUN;
+    while( status == LZMA_OK ) {
+        if( stream.avail_in == 0 && action == LZMA_RUN ) {
+            action = chunks( in ) ? LZMA_RUN : LZMA_FINISH;
+            stream.next_in = reinterpret_cast< const std::uint8_t* >( in.data() );
+            stream.avail_in = in.size();
+        }
+        stream.next_out = reinterpret_cast< std::uint8_t* >( out.data() );
+        stream.avail_out = out.size();
+        status = lzma_code( &stream, action );
+        content.append( out.data(), out.size() - stream.avail_out );
+    }
+    lzma_end( &stream );
+    if( status != LZMA_STREAM_END ) {
+        throw std::runtime_error( "Corrupt compressed data in " + path.string() );
+    }
+    return content;
+#else
+    throw std::runtime_error( "svd2cpp was built without liblzma, can't read " + path.string() );
+#endif
+}
+
+std::uint32_t le16( const char* bytes )
+{
+    const auto* b = reinterpret_cast< const unsigned char* >( bytes );
+    return static_cast< std::uint32_t >( b[0] | b[1] << 8 );
+}
+
+std::uint32_t le32( const char* bytes )
+{
+    const auto* b = reinterpret_cast< const unsigned char* >( bytes );
+    return static_cast< std::uint32_t >( b[0] | b[1] << 8 | b[2] << 16 ) | static_cast< std::uint32_t >( b[3] ) << 24;
+}
+
+struct ZipEntry
+{
+    std::string name;
+    std::uint32_t method = 0;
+    std::uint32_t compressedSize = 0;
+    std::uint32_t size = 0;
+    std::uint32_t headerOffset = 0;
+};
+
+// Entries of the central directory, the archive isn't read beyond it
+std::vector< ZipEntry > zipEntries( std::ifstream& file, const std::string& name )
+{
+    //The end of central directory record is in the last 22 + 65535 bytes
+    file.seekg( 0, std::ios::end );
+    const std::uint64_t size = static_cast< std::uint64_t >( file.tellg() );
+    const std::uint64_t tail = std::min< std::uint64_t >( size, 22 + 65535 );
+    std::vector< char > buffer( static_cast< std::size_t >( tail ) );
+    file.seekg( static_cast< std::streamoff >( size - tail ) );
+    file.read( buffer.data(), static_cast< std::streamsize >( tail ) );
+    std::size_t end = buffer.size() < 22 ? std::string::npos : buffer.size() - 22;
+    while( end != std::string::npos && le32( buffer.data() + end ) != 0x06054b50 ) {
+        end = end == 0 ? std::string::npos : end - 1;
+    }
+    if( !file || end == std::string::npos ) {
+        throw std::runtime_error( name + " isn't a zip archive" );
+    }
+    const std::uint32_t count = le16( buffer.data() + end + 10 );
+    const std::uint32_t directorySize = le32( buffer.data() + end + 12 );
+    const std::uint32_t directoryOffset = le32( buffer.data() + end + 16 );
+    if( directoryOffset == 0xffffffff || count == 0xffff ) {
+        throw std::runtime_error( name + " is a zip64 archive, which isn't supported" );
+    }
+
+    std::vector< char > directory( directorySize );
+    file.seekg( directoryOffset );
+    file.read( directory.data(), static_cast< std::streamsize >( directory.size() ) );
+    std::vector< ZipEntry > entries;
+    for( std::size_t at = 0; entries.size() < count; ) {
+        if( !file || at + 46 > directory.size() || le32( directory.data() + at ) != 0x02014b50 ) {
+            throw std::runtime_error( "Corrupt central directory in " + name );
+        }
+        const char* record = directory.data() + at;
+        ZipEntry& entry = entries.emplace_back();
+        entry.method = le16( record + 10 );
+        entry.compressedSize = le32( record + 20 );
+        entry.size = le32( record + 24 );
+        entry.headerOffset = le32( record + 42 );
+        const std::uint32_t nameLength = le16( record + 28 );
+        if( at + 46 + nameLength > directory.size() ) {
+            throw std::runtime_error( "Corrupt central directory in " + name );
+        }
+        entry.name.assign( record + 46, nameLength );
+        at += 46 + nameLength + le16( record + 30 ) + le16( record + 32 );
+    }
+    return entries;
+}
+
+// The member named in full or, if no member has that path, by file name.
+// Without a member name the archive must hold a single .svd file.
+const ZipEntry& findMember( const std::vector< ZipEntry >& entries, const std::string& member, const std::string& name )
+{
+    std::vector< const ZipEntry* > matches;
+    for( auto& entry : entries ) {
+        if( entry.name == member ) {
+            return entry;
+        }
+        const std::string fileName = fs::path( entry.name ).filename().string();
+        if( member.empty() ? isSvdFile( entry.name ) : fileName == member ) {
+            matches.push_back( &entry );
+        }
+    }
+    if( matches.size() == 1 ) {
+        return *matches.front();
+    }
+    if( member.empty() ) {
+        throw std::runtime_error( name + " holds " + std::to_string( matches.size() )
+            + " .svd files, name one as " + name + ":<path in the archive>" );
+    }
+    throw std::runtime_error( matches.empty() ? member + " isn't in " + name
+                                              : member + " matches several files in " + name );
+}
+
+std::string readZipMember( const fs::path& path, const std::string& member )
+{
+    const std::string name = path.string();
+    std::ifstream file = openInput( path );
+    const std::vector< ZipEntry > entries = zipEntries( file, name );
+    const ZipEntry& entry = findMember( entries, member, name );
+    const std::string entryName = name + ":" + entry.name;
+    char header[30];
+    file.seekg( entry.headerOffset );
+    file.read( header, sizeof( header ) );
+    if( !file || le32( header ) != 0x04034b50 ) {
+        throw std::runtime_error( "Corrupt local header of " + entryName );
+    }
+    file.seekg( le16( header + 26 ) + le16( header + 28 ), std::ios::cur );
+    if( entry.method == 0 ) {
+        std::string content( entry.size, '\0' );
+        file.read( content.data(), static_cast< std::streamsize >( content.size() ) );
+        if( !file ) {
+            throw std::runtime_error( "Couldn't read " + entryName );
+        }
+        return content;
+    }
+    if( entry.method != 8 ) {
+        throw std::runtime_error( entryName + " uses an unsupported compression method" );
+    }
+#ifdef SVD2CPP_HAVE_ZLIB
+    return inflateStream( -MAX_WBITS, FileChunks{ std::move( file ), entry.compressedSize }, entry.size, entryName );
+#else
+    throw std::runtime_error( "svd2cpp was built without zlib, can't read " + entryName );
+#endif
+}
+
+} // namespace
+
+std::string read( const std::string& inputFile )
+{
+    const std::string lower = lowercase( inputFile );
+    if( isArchive( inputFile ) ) {
+        const std::size_t separator = memberSeparator( inputFile );
+        if( separator == std::string::npos ) {
+            return readZipMember( inputFile, {} );
+        }
+        return readZipMember( inputFile.substr( 0, separator ), inputFile.substr( separator + 1 ) );
+    }
+    if( endsWith( lower, ".gz" ) ) {
+        return readGzip( inputFile );
+    }
+    if( endsWith( lower, ".xz" ) ) {
+        return readXz( inputFile );
+    }
+    return readPlain( inputFile );
+}
+
+bool isPacked( const std::string& inputFile )
+{
+    const std::string lower = lowercase( inputFile );
+    return isArchive( inputFile ) || endsWith( lower, ".gz" ) || endsWith( lower, ".xz" );
+}
+
+fs::path fileOf( const std::string& inputFile )
+{
+    const std::size_t separator = memberSeparator( inputFile );
+    return separator == std::string::npos ? fs::path( inputFile ) : fs::path( inputFile.substr( 0, separator ) );
+}
+
+std::string stemOf( const std::string& inputFile )
+{
+    const std::size_t separator = memberSeparator( inputFile );
+    fs::path name = fs::path( separator == std::string::npos ? inputFile : inputFile.substr( separator + 1 ) ).filename();
+    const std::string extension = lowercase( name.extension().string() );
+    if( extension == ".gz" || extension == ".xz" ) {
+        name = name.stem();
+    }
+    return name.stem().string();
+}
+
+bool isSvdFile( const fs::path& path )
+{
+    const std::string lower = lowercase( path.filename().string() );
+    return endsWith( lower, ".svd" ) || endsWith( lower, ".svd.gz" ) || endsWith( lower, ".svd.xz" );
+}
+
+} // namespace input
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// Inputs besides plain .svd files: gzip or xz compressed files (.svd.gz,
+// .svd.xz) and members of zip archives such as CMSIS packs, named
+// "Vendor.Device_DFP.pack:CMSIS/SVD/DEVICE.svd". They are decompressed in
+// memory, never to a temporary file.
+namespace input {
+
+// Whole content of the input, decompressed. Throws std::runtime_error if it
+// can't be read, or svd2cpp was built without the library it needs.
+std::string read( const std::string& inputFile );
+
+// True if the input has to go through read() instead of being opened
+bool isPacked( const std::string& inputFile );
+
+// File holding the input, the archive for a member
+std::filesystem::path fileOf( const std::string& inputFile );
+
+// Device name part of the input's file name: "STM32F40x" for
+// "STM32F40x.svd", "STM32F40x.svd.gz" or "DFP.pack:CMSIS/SVD/STM32F40x.svd"
+std::string stemOf( const std::string& inputFile );
+
+// .svd, .svd.gz and .svd.xz files, for collecting directories
+bool isSvdFile( const std::filesystem::path& path );
+
+} // namespace input
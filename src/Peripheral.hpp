@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,9 +17,15 @@ struct Field
 {
     std::string name;
     std::string description;
-    unsigned int bitOffset;
-    unsigned int bitWidth;
-    EAccess fieldAccess;
+    std::string derivedFrom;
+    unsigned int bitOffset = 0;
+    unsigned int bitWidth = 0;
+    EAccess fieldAccess = EAccess::Read_Write;
+    bool operator==( const Field& other ) const
+    {
+        return name == other.name && description == other.description && derivedFrom == other.derivedFrom
+            && bitOffset == other.bitOffset && bitWidth == other.bitWidth && fieldAccess == other.fieldAccess;
+    }
     void display() const
     {
         std::cout << "\t\tname: " << name << std::endl
@@ -33,11 +41,27 @@ struct Register
 {
     std::string name;
     std::string description;
-    unsigned int addressOffset;
-    unsigned int size;
-    EAccess registerAccess;
-    unsigned int resetValue;
+    std::string derivedFrom;
+    unsigned int addressOffset = 0;
+    unsigned int size = 0;
+    EAccess registerAccess = EAccess::Read_Write;
+    std::uint64_t resetValue = 0;
+    // <dim> array of dim registers dimIncrement bytes apart, dim is 0 otherwise
+    unsigned int dim = 0;
+    unsigned int dimIncrement = 0;
+    std::string dimIndex;
     std::vector< Field > fields;
+    // svd::ERegisterElement bits of the elements the register got from the
+    // file or from a default, not part of the register's value
+    unsigned int specified = 0;
+
+    bool operator==( const Register& other ) const
+    {
+        return name == other.name && description == other.description && derivedFrom == other.derivedFrom
+            && addressOffset == other.addressOffset && size == other.size && registerAccess == other.registerAccess && resetValue == other.resetValue
+            && dim == other.dim && dimIncrement == other.dimIncrement && dimIndex == other.dimIndex
+            && fields == other.fields;
+    }
 
     void display() const
     {
@@ -47,6 +71,11 @@ struct Register
                   << "\tsize: " << size << std::endl
                   << "\tregisterAccess: " << (int)registerAccess << std::endl
                   << "\tresetValue: " << resetValue << std::endl;
+        if( dim != 0 ) {
+            std::cout << "\tdim: " << dim << std::endl
+                      << "\tdimIncrement: " << dimIncrement << std::endl
+                      << "\tdimIndex: " << dimIndex << std::endl;
+        }
 
         std::cout << "\tfields: " << std::endl;
         for( auto& i : fields ) {
@@ -57,33 +86,54 @@ struct Register
 
 struct AddressBlock
 {
-    unsigned int offset;
-    unsigned int size;
+    unsigned int offset = 0;
+    unsigned int size = 0;
+    bool operator==( const AddressBlock& other ) const
+    {
+        return offset == other.offset && size == other.size;
+    }
     void display() const
     {
         std::cout << std::endl << "\toffset: " << offset << std::endl << "\tsize: " << size << std::endl;
     }
 };
 
+using RegisterList = std::vector< Register >;
+
 struct Peripheral
 {
     std::string name;
     std::string description;
     std::string groupName;
-    unsigned int baseAddress;
+    std::string derivedFrom;
+    unsigned int baseAddress = 0;
     AddressBlock addressBlock;
-    std::vector< Register > registers;
+    // Shared by a peripheral and every peripheral derived from it, may be null
+    std::shared_ptr< RegisterList > registers;
+
+    inline const RegisterList& getRegisters() const
+    {
+        static const RegisterList noRegisters;
+        return registers ? *registers : noRegisters;
+    }
+    bool operator==( const Peripheral& other ) const
+    {
+        return name == other.name && description == other.description && groupName == other.groupName
+            && derivedFrom == other.derivedFrom && baseAddress == other.baseAddress
+            && addressBlock == other.addressBlock && getRegisters() == other.getRegisters();
+    }
     void display() const
     {
         std::cout << std::endl
                   << "name: " << name << std::endl
                   << "description: " << description << std::endl
                   << "groupName: " << groupName << std::endl
+                  << "derivedFrom: " << derivedFrom << std::endl
                   << "baseAddress: " << baseAddress << std::endl
                   << "addressBlock: ";
         addressBlock.display();
         std::cout << "registers: " << std::endl;
-        for( auto& i : registers ) {
+        for( auto& i : getRegisters() ) {
             i.display();
         }
     }
@@ -0,0 +1,83 @@
+#include "PeripheralCache.hpp"
+
+#include <iterator>
+#include <unordered_set>
+#include <fmt/format.h>
+
+namespace {
+
+//Strings are length-prefixed so no two models share a fingerprint
+void appendString( std::string& out, std::string_view text )
+{
+    fmt::format_to( std::back_inserter( out ), "{}:{}", text.size(), text );
+}
+
+std::string fingerprintOf( const DeviceModel& model, const PeripheralRecord& peripheral, const EmitOptions& emit )
+{
+    std::string out;
+    auto it = std::back_inserter( out );
+    fmt::format_to( it, "{} {} {} ", emit.overlay, emit.lean, peripheral.baseAddress );
+    appendString( out, model.str( peripheral.name ) );
+    appendString( out, emit.atomic.policyOf( model, peripheral ) );
+    const std::uint32_t owner = classOf( model, peripheral, emit );
+    if( owner != model.indexOf( peripheral ) ) {
+        //An alias only depends on the name of the class it refers to
+        appendString( out, model.str( model.peripheralAt( owner ).name ) );
+        return out;
+    }
+    fmt::format_to( it, "{} {}|", peripheral.addressBlockOffset, peripheral.addressBlockSize );
+    for( auto& registe : model.registersOf( peripheral ) ) {
+        appendString( out, model.str( registe.name ) );
+        appendString( out, model.str( registe.dimIndex ) );
+        fmt::format_to( it, "{} {} {} {} {} {} ", registe.addressOffset, registe.size, registe.resetValue,
+            static_cast< int >( registe.registerAccess ), registe.dim, registe.dimIncrement );
+        if( registe.fieldLayout != noFieldLayout ) {
+            //Shared layouts are named after their first register and number
+            const RegisterRecord& first = model.registerAt( model.getFieldLayouts()[registe.fieldLayout] );
+            fmt::format_to( it, "{} ", registe.fieldLayout );
+            appendString( out, model.str( first.name ) );
+            out += '|';
+            continue;
+        }
+        for( auto& field : model.fieldsOf( registe ) ) {
+            appendString( out, model.str( field.name ) );
+            fmt::format_to( it, "{} {} {} ", field.bitOffset, field.bitWidth, static_cast< int >( field.fieldAccess ) );
+        }
+        out += '|';
+    }
+    return out;
+}
+
+} // namespace
+
+void PeripheralCache::update( const DeviceModel& model, const EmitOptions& emit )
+{
+    rebuilt = 0;
+    byIndex.clear();
+    std::unordered_set< std::string > seen;
+    for( auto& peripheral : model.getPeripherals() ) {
+        std::string name( model.str( peripheral.name ) );
+        if( seen.count( name ) ) {
+            //Peripherals sharing a name keep separate entries
+            name += '\n' + std::to_string( model.indexOf( peripheral ) );
+        }
+        std::string fingerprint = fingerprintOf( model, peripheral, emit );
+        Entry& entry = entries[name];
+        if( entry.text.empty() || entry.fingerprint != fingerprint ) {
+            entry.fingerprint = std::move( fingerprint );
+            entry.text.clear();
+            PeripheralBuilder( model, peripheral, emit ).build( entry.text );
+            ++rebuilt;
+        }
+        byIndex.push_back( &entry );
+        seen.insert( std::move( name ) );
+    }
+    for( auto it = entries.begin(); it != entries.end(); ) {
+        it = seen.count( it->first ) ? std::next( it ) : entries.erase( it );
+    }
+}
+
+void CachedPeripheralBuilder::build( OutputSink& out ) const
+{
+    out += cache.textOf( peripheral );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Builders.hpp"
+#include "DeviceModel.hpp"
+#include "IBuilder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Class or alias text of every peripheral, kept between generations of the
+// same device so that only peripherals whose emitted text can have changed
+// go through PeripheralBuilder again, see --watch
+struct PeripheralCache
+{
+    // Emits the peripherals of model whose fingerprint differs from the
+    // previous update and forgets the ones model no longer has
+    void update( const DeviceModel& model, const EmitOptions& emit );
+    // Text of the peripheral at index of the last updated model
+    inline const std::string& textOf( std::uint32_t index ) const
+    {
+        return byIndex[index]->text;
+    }
+    // Peripherals emitted by the last update, the others were reused
+    inline std::size_t getRebuilt() const
+    {
+        return rebuilt;
+    }
+    // Peripherals of the last updated model
+    inline std::size_t size() const
+    {
+        return byIndex.size();
+    }
+
+private:
+    struct Entry
+    {
+        // Everything PeripheralBuilder reads, strings resolved
+        std::string fingerprint;
+        std::string text;
+    };
+    // By peripheral name
+    std::unordered_map< std::string, Entry > entries;
+    std::vector< const Entry* > byIndex;
+    std::size_t rebuilt = 0;
+};
+
+// PeripheralBuilder replaced by the text cached for the peripheral
+struct CachedPeripheralBuilder : public IBuilder
+{
+    CachedPeripheralBuilder( const PeripheralCache& cache_, std::uint32_t peripheral_ )
+        : cache( cache_ )
+        , peripheral( peripheral_ )
+    {
+    }
+    void build( OutputSink& out ) const final;
+
+private:
+    const PeripheralCache& cache;
+    const std::uint32_t peripheral;
+};
@@ -0,0 +1,161 @@
+#include "RegenCache.hpp"
+#include "Builders.hpp"
+#include "InputFile.hpp"
+#include "version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Options that change the generated files, anything else (parser backend,
+// jobs, paths) must not invalidate the cache
+const std::vector< std::string > flagOptions = { "dedup", "overlay", "lean" };
+const std::vector< std::string > valueOptions = { "split" };
+const std::vector< std::string > listOptions = { "only", "exclude", "atomic" };
+
+// 64 bit FNV-1a, two differently seeded runs make up a 128 bit key
+struct Fnv1a
+{
+    std::uint64_t state;
+
+    void update( std::string_view bytes )
+    {
+        for( unsigned char byte : bytes ) {
+            state = ( state ^ byte ) * 0x100000001b3ull;
+        }
+    }
+};
+
+bool readFile( const fs::path& path, std::string& content )
+{
+    std::ifstream file( path, std::ios::binary );
+    if( !file ) {
+        return false;
+    }
+    content.assign( std::istreambuf_iterator< char >( file ), std::istreambuf_iterator< char >() );
+    return !file.bad();
+}
+
+// Compares in chunks, so checking a big header doesn't load a second copy
+bool sameContent( const fs::path& path, std::string_view content )
+{
+    std::ifstream file( path, std::ios::binary );
+    char chunk[64 * 1024];
+    while( file && !content.empty() ) {
+        file.read( chunk, static_cast< std::streamsize >( std::min( sizeof( chunk ), content.size() ) ) );
+        const auto count = static_cast< std::size_t >( file.gcount() );
+        if( count == 0 || content.compare( 0, count, chunk, count ) != 0 ) {
+            return false;
+        }
+        content.remove_prefix( count );
+    }
+    return content.empty();
+}
+
+} // namespace
+
+bool writeIfChanged( const fs::path& path, std::string_view content )
+{
+    std::error_code ec;
+    if( fs::file_size( path, ec ) == content.size() && !ec && sameContent( path, content ) ) {
+        return true;
+    }
+    std::ofstream oFile( path, std::ios::binary );
+    oFile.write( content.data(), static_cast< std::streamsize >( content.size() ) );
+    oFile.close();
+    return static_cast< bool >( oFile );
+}
+
+RegenCache::RegenCache( const cxxopts::ParseResult& options_ )
+    : options( options_ )
+{
+    if( options.count( "cache-dir" ) ) {
+        cacheDir = options["cache-dir"].as< std::string >();
+    }
+}
+
+std::optional< std::string > RegenCache::keyOf( const std::string& inputFile ) const
+{
+    std::string content;
+    if( input::isPacked( inputFile ) ) {
+        //Keyed by the document, so recompressing the same .svd still hits
+        try {
+            content = input::read( inputFile );
+        }
+        catch( const std::exception& ) {
+            return std::nullopt;
+        }
+    }
+    else if( !readFile( inputFile, content ) ) {
+        return std::nullopt;
+    }
+    //The version strings stay the same between releases, the output format
+    //version changes with the emitters
+    std::string settings = fmt::format( "svd2cpp {} {} output {}\n", version::getVersionInfo(),
+        version::getBuildInfo(), outputFormatVersion );
+    for( auto& name : flagOptions ) {
+        settings += options.count( name ) ? name + "\n" : "";
+    }
+    for( auto& name : valueOptions ) {
+        settings += options.count( name ) ? name + "=" + options[name].as< std::string >() + "\n" : "";
+    }
+    for( auto& name : listOptions ) {
+        if( options.count( name ) ) {
+            for( auto& value : options[name].as< std::vector< std::string > >() ) {
+                settings += name + "=" + value + "\n";
+            }
+        }
+    }
+
+    Fnv1a low{ 0xcbf29ce484222325ull }, high{ 0x84222325cbf29ce4ull };
+    for( auto* hash : { &low, &high } ) {
+        hash->update( settings );
+        hash->update( content );
+    }
+    return fmt::format( "{:016x}{:016x}", high.state, low.state );
+}
+
+std::optional< std::vector< GeneratedFile > > RegenCache::load( const std::string& key ) const
+{
+    std::error_code ec;
+    std::vector< GeneratedFile > files;
+    for( auto& entry : fs::directory_iterator( cacheDir / key, ec ) ) {
+        GeneratedFile& file = files.emplace_back();
+        file.name = entry.path().filename().string();
+        if( !readFile( entry.path(), file.content ) ) {
+            return std::nullopt;
+        }
+    }
+    if( ec || files.empty() ) {
+        return std::nullopt;
+    }
+    return files;
+}
+
+void RegenCache::store( const std::string& key, const std::vector< GeneratedFile >& files ) const
+{
+    //Fill a private directory and rename it, so readers and other workers
+    //producing the same key never see a partial entry
+    std::error_code ec;
+    const fs::path entry = cacheDir / key;
+    const auto unique = std::hash< std::thread::id >()( std::this_thread::get_id() )
+        ^ static_cast< std::size_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+    const fs::path staging = cacheDir / ( key + "." + std::to_string( unique ) );
+    fs::remove_all( staging, ec );
+    fs::create_directories( staging, ec );
+    bool written = !ec;
+    for( auto& file : files ) {
+        written = written && writeIfChanged( staging / file.name, file.content );
+    }
+    if( written ) {
+        fs::rename( staging, entry, ec );
+    }
+    fs::remove_all( staging, ec );
+}
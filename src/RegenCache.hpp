@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cxxopts.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A generated file, name is relative to the output directory in split mode
+struct GeneratedFile
+{
+    std::string name;
+    std::string content;
+};
+
+// Writes content unless the file already holds exactly these bytes, so
+// unchanged outputs keep their mtime. Returns false on write errors.
+bool writeIfChanged( const std::filesystem::path& path, std::string_view content );
+
+// Content addressed cache of generated files. The key hashes the .svd bytes,
+// the generator's outputFormatVersion and every option that changes the output; a hit
+// restores the files without parsing. Disabled unless --cache-dir is given.
+struct RegenCache
+{
+    RegenCache( const cxxopts::ParseResult& options_ );
+    inline bool enabled() const
+    {
+        return !cacheDir.empty();
+    }
+    // Empty if the input can't be read, the generator then reports the error
+    std::optional< std::string > keyOf( const std::string& inputFile ) const;
+    std::optional< std::vector< GeneratedFile > > load( const std::string& key ) const;
+    void store( const std::string& key, const std::vector< GeneratedFile >& files ) const;
+
+private:
+    const cxxopts::ParseResult& options;
+    std::filesystem::path cacheDir;
+};
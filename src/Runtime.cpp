@@ -0,0 +1,316 @@
+#include "Runtime.hpp"
+#include "RegenCache.hpp"
+
+namespace runtime {
+
+namespace {
+
+const std::string_view regBase = R"RUNTIME(#pragma once
+// svd2cpp runtime, written by the generator next to the headers it produces.
+// Registers and fields are types. Every access is one volatile load or store
+// of the register's width at a compile-time address.
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace FEmbed {
+
+namespace detail {
+
+// Width bits at Offset
+template<typename T, unsigned int Offset, unsigned int Width>
+constexpr T fieldMask()
+{
+    static_assert( Offset + Width <= sizeof( T ) * 8, "Field exceeds its register" );
+    if constexpr( Width >= 64 ) {
+        return static_cast<T>( ~0ull );
+    }
+    else {
+        return static_cast<T>( ( ( 1ull << Width ) - 1 ) << Offset );
+    }
+}
+
+template<typename F, typename... Fs>
+struct First {
+    using Type = F;
+};
+
+template<typename F, typename... Fs>
+constexpr bool sameRegister()
+{
+    return ( std::is_same_v<typename Fs::RegisterType, typename F::RegisterType> && ... );
+}
+
+} // namespace detail
+
+enum class Access { ReadWrite, ReadOnly, WriteOnly };
+
+// Atomic policies, a register's "using Atomic = ..." tells how set, reset and
+// toggle change one of its fields with a single store. Registers without one
+// are read-modify-written.
+struct ReadModifyWrite {};
+// Cortex-M3/M4 bit-band, every bit of the first MB of SRAM and peripherals
+// has a word in the alias region, single-bit fields are set and reset there
+struct BitBand {};
+// Vendor alias registers at the register's address plus an offset, writing
+// 1 bits sets, clears or toggles them. 0 if the part doesn't have the alias.
+template<std::uintptr_t SetOffset, std::uintptr_t ClearOffset, std::uintptr_t ToggleOffset>
+struct AliasOffsets {};
+
+enum class AtomicOp { Set, Clear, Toggle };
+
+namespace detail {
+
+template<typename R, typename = void>
+struct AtomicOf {
+    using Type = ReadModifyWrite;
+};
+
+template<typename R>
+struct AtomicOf<R, std::void_t<typename R::Atomic>> {
+    using Type = typename R::Atomic;
+};
+
+template<typename P, AtomicOp Op>
+struct AliasOffset {
+    constexpr static std::uintptr_t value = 0;
+};
+
+template<std::uintptr_t S, std::uintptr_t C, std::uintptr_t T, AtomicOp Op>
+struct AliasOffset<AliasOffsets<S, C, T>, Op> {
+    constexpr static std::uintptr_t value = Op == AtomicOp::Set ? S : Op == AtomicOp::Clear ? C : T;
+};
+
+// Alias word of bit Bit at Addr, 0 outside the bit-band regions
+constexpr std::uintptr_t bitBandAlias( std::uintptr_t addr, unsigned int bit )
+{
+    const std::uintptr_t region = addr & 0xfff00000;
+    if( region != 0x20000000 && region != 0x40000000 ) {
+        return 0;
+    }
+    return region + 0x2000000 + ( addr - region ) * 32 + bit * 4;
+}
+
+// The single store doing Op on field F, if its register's policy has one
+template<typename F, AtomicOp Op>
+struct AtomicStore {
+    using Policy = typename AtomicOf<typename F::RegisterType>::Type;
+    using T = typename F::ValueType;
+    constexpr static std::uintptr_t bitBand = std::is_same_v<Policy, BitBand> && F::width == 1
+            && Op != AtomicOp::Toggle ? bitBandAlias( F::registerAddress, F::offset ) : 0;
+    constexpr static std::uintptr_t alias = AliasOffset<Policy, Op>::value;
+    constexpr static bool available = bitBand != 0 || alias != 0;
+
+    static inline void store()
+    {
+        static_assert( F::writable, "Field is read-only" );
+        if constexpr( bitBand != 0 ) {
+            //The alias is accessed with the register's width
+            *reinterpret_cast<volatile T*>( bitBand ) = Op == AtomicOp::Set ? 1 : 0;
+        }
+        else {
+            *reinterpret_cast<volatile T*>( F::registerAddress + alias ) = F::mask;
+        }
+    }
+};
+
+} // namespace detail
+
+// True if Op on field F is a single store
+template<typename F, AtomicOp Op>
+constexpr bool isAtomic = detail::AtomicStore<F, Op>::available;
+
+// Reset is the register's resetValue, the base of init() and assign()
+template<typename T, std::uintptr_t Addr, T Reset = 0, Access A = Access::ReadWrite>
+class Register {
+  public:
+    using ValueType = T;
+    constexpr static std::uintptr_t registerAddress = Addr;
+    constexpr static T resetValue = Reset;
+    constexpr static Access access = A;
+    constexpr static bool readable = A != Access::WriteOnly;
+    constexpr static bool writable = A != Access::ReadOnly;
+
+    static inline volatile T& ref() { return *reinterpret_cast<volatile T*>( Addr ); }
+    static inline T read()
+    {
+        static_assert( readable, "Register is write-only" );
+        return ref();
+    }
+    static inline void write( T value )
+    {
+        static_assert( writable, "Register is read-only" );
+        ref() = value;
+    }
+};
+
+// Field of the register class R, the field's access narrows the register's
+template<typename R, unsigned int Offset, unsigned int Width, Access A = Access::ReadWrite>
+class Filed {
+  public:
+    using RegisterType = R;
+    using ValueType = typename R::ValueType;
+    constexpr static std::uintptr_t registerAddress = R::registerAddress;
+    constexpr static unsigned int offset = Offset;
+    constexpr static unsigned int width = Width;
+    constexpr static ValueType mask = detail::fieldMask<ValueType, Offset, Width>();
+    constexpr static bool readable = R::readable && A != Access::WriteOnly;
+    constexpr static bool writable = R::writable && A != Access::ReadOnly;
+
+    // value moved to the field's bits
+    constexpr static ValueType shifted( ValueType value )
+    {
+        return static_cast<ValueType>( ( value << Offset ) & mask );
+    }
+    static inline ValueType read()
+    {
+        static_assert( readable, "Field is write-only" );
+        return static_cast<ValueType>( ( R::ref() & mask ) >> Offset );
+    }
+};
+
+// Field F with the compile-time value V, see modify()
+template<typename F, typename F::ValueType V>
+struct Value {
+    static_assert( F::shifted( V ) >> F::offset == V, "Value doesn't fit the field" );
+    using ValueType = typename F::ValueType;
+    using RegisterType = typename F::RegisterType;
+    constexpr static bool writable = F::writable;
+    constexpr static ValueType mask = F::mask;
+    constexpr static ValueType value = F::shifted( V );
+};
+
+// Writes several fields of one register with a single load and store, the
+// other fields keep their value: write<CR1::UE, CR1::M>( 1, 0 )
+template<typename... Fs>
+inline void write( typename Fs::ValueType... values )
+{
+    static_assert( sizeof...( Fs ) > 0, "write needs at least one field" );
+    static_assert( detail::sameRegister<Fs...>(), "All fields must belong to the same register" );
+    static_assert( ( Fs::writable && ... ), "Field is read-only" );
+    using R = typename detail::First<Fs...>::Type::RegisterType;
+    static_assert( R::readable, "Register is write-only, use init()" );
+    using T = typename R::ValueType;
+    constexpr T mask = static_cast<T>( ( Fs::mask | ... ) );
+    const T value = static_cast<T>( ( Fs::shifted( values ) | ... ) );
+    volatile T& reg = R::ref();
+    reg = static_cast<T>( ( reg & static_cast<T>( ~mask ) ) | value );
+}
+
+// Like write with values known at compile time, mask and value are both
+// constants: modify<Value<CR1::UE, 1>, Value<CR1::M, 0>>()
+template<typename... Vs>
+inline void modify()
+{
+    static_assert( sizeof...( Vs ) > 0, "modify needs at least one field" );
+    static_assert( detail::sameRegister<Vs...>(), "All fields must belong to the same register" );
+    static_assert( ( Vs::writable && ... ), "Field is read-only" );
+    using R = typename detail::First<Vs...>::Type::RegisterType;
+    static_assert( R::readable, "Register is write-only, use assign()" );
+    using T = typename R::ValueType;
+    constexpr T mask = static_cast<T>( ( Vs::mask | ... ) );
+    constexpr T value = static_cast<T>( ( Vs::value | ... ) );
+    volatile T& reg = R::ref();
+    reg = static_cast<T>( ( reg & static_cast<T>( ~mask ) ) | value );
+}
+
+// Stores the given fields over the register's reset value, a single store
+// without reading the register first: init<CR1::UE, CR1::M>( 1, 0 )
+template<typename... Fs>
+inline void init( typename Fs::ValueType... values )
+{
+    static_assert( sizeof...( Fs ) > 0, "init needs at least one field" );
+    static_assert( detail::sameRegister<Fs...>(), "All fields must belong to the same register" );
+    static_assert( ( Fs::writable && ... ), "Field is read-only" );
+    using R = typename detail::First<Fs...>::Type::RegisterType;
+    static_assert( R::writable, "Register is read-only" );
+    using T = typename R::ValueType;
+    constexpr T mask = static_cast<T>( ( Fs::mask | ... ) );
+    R::ref() = static_cast<T>( ( R::resetValue & static_cast<T>( ~mask ) ) | ( Fs::shifted( values ) | ... ) );
+}
+
+// Like init with values known at compile time, the stored value is a
+// constant: assign<Value<CR1::UE, 1>, Value<CR1::M, 0>>()
+template<typename... Vs>
+inline void assign()
+{
+    static_assert( sizeof...( Vs ) > 0, "assign needs at least one field" );
+    static_assert( detail::sameRegister<Vs...>(), "All fields must belong to the same register" );
+    static_assert( ( Vs::writable && ... ), "Field is read-only" );
+    using R = typename detail::First<Vs...>::Type::RegisterType;
+    static_assert( R::writable, "Register is read-only" );
+    using T = typename R::ValueType;
+    constexpr T mask = static_cast<T>( ( Vs::mask | ... ) );
+    constexpr T value = static_cast<T>( ( R::resetValue & static_cast<T>( ~mask ) ) | ( Vs::value | ... ) );
+    R::ref() = value;
+}
+
+// set, reset and toggle are a single store when the register's Atomic
+// policy allows it, otherwise a read-modify-write
+template<typename F>
+inline void set()
+{
+    if constexpr( isAtomic<F, AtomicOp::Set> ) {
+        detail::AtomicStore<F, AtomicOp::Set>::store();
+    }
+    else {
+        modify<Value<F, static_cast<typename F::ValueType>( F::mask >> F::offset )>>();
+    }
+}
+
+template<typename F>
+inline void set( typename F::ValueType value )
+{
+    write<F>( value );
+}
+
+template<typename F>
+inline void reset()
+{
+    if constexpr( isAtomic<F, AtomicOp::Clear> ) {
+        detail::AtomicStore<F, AtomicOp::Clear>::store();
+    }
+    else {
+        modify<Value<F, 0>>();
+    }
+}
+
+template<typename F>
+inline void toggle()
+{
+    if constexpr( isAtomic<F, AtomicOp::Toggle> ) {
+        detail::AtomicStore<F, AtomicOp::Toggle>::store();
+    }
+    else {
+        using R = typename F::RegisterType;
+        static_assert( F::writable, "Field is read-only" );
+        static_assert( R::readable, "Register is write-only" );
+        volatile typename R::ValueType& reg = R::ref();
+        reg = static_cast<typename R::ValueType>( reg ^ F::mask );
+    }
+}
+
+template<typename F>
+inline typename F::ValueType read()
+{
+    return F::read();
+}
+
+} // namespace FEmbed
+)RUNTIME";
+
+} // namespace
+
+std::string_view regBaseHeader()
+{
+    return regBase;
+}
+
+bool writeRegBase( const std::filesystem::path& directory )
+{
+    return writeIfChanged( directory / regBaseName, regBase );
+}
+
+} // namespace runtime
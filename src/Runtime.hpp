@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+// RegBase.h, the runtime every generated header includes. It is compiled
+// into svd2cpp and written next to the generated headers, so they always
+// match the generator that produced them.
+namespace runtime {
+
+constexpr std::string_view regBaseName = "RegBase.h";
+
+std::string_view regBaseHeader();
+
+// Writes RegBase.h into directory unless it is already up to date
+bool writeRegBase( const std::filesystem::path& directory );
+
+} // namespace runtime
@@ -0,0 +1,99 @@
+#include "Selection.hpp"
+#include "Glob.hpp"
+
+#include <unordered_map>
+
+namespace svd {
+
+namespace {
+
+//What the parsers store for elements missing from the .svd file
+const std::string_view noValue = "Not found";
+
+bool anyMatches( const std::vector< std::string >& patterns, std::string_view name, std::string_view groupName )
+{
+    for( auto& pattern : patterns ) {
+        if( globMatch( pattern, name ) || globMatch( pattern, groupName ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// First component of a dotted derivedFrom path, empty for plain names
+std::string_view peripheralOfPath( std::string_view path, std::size_t minDots )
+{
+    std::size_t dots = 0;
+    for( char c : path ) {
+        dots += c == '.' ? 1 : 0;
+    }
+    return dots >= minDots ? path.substr( 0, path.find( '.' ) ) : std::string_view();
+}
+
+} // namespace
+
+PeripheralFilter::PeripheralFilter( std::vector< std::string > only_, std::vector< std::string > exclude_ )
+    : only( std::move( only_ ) )
+    , exclude( std::move( exclude_ ) )
+{
+}
+
+bool PeripheralFilter::matches( std::string_view name, std::string_view groupName ) const
+{
+    if( !only.empty() && !anyMatches( only, name, groupName ) ) {
+        return false;
+    }
+    return !anyMatches( exclude, name, groupName );
+}
+
+std::vector< bool > selectPeripherals( const PeripheralFilter& filter, const std::vector< Peripheral >& peripherals )
+{
+    //First peripheral of a name wins, like in DerivationResolver
+    std::unordered_map< std::string_view, std::size_t > indexOfName;
+    for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+        indexOfName.emplace( peripherals[i].name, i );
+    }
+
+    //groupName isn't inherited before derivations are resolved, look it up
+    auto groupOf = [&]( std::size_t index ) {
+        for( std::size_t steps = 0; steps < peripherals.size(); ++steps ) {
+            const Peripheral& peripheral = peripherals[index];
+            auto base = indexOfName.find( peripheral.derivedFrom );
+            if( ( !peripheral.groupName.empty() && peripheral.groupName != noValue ) || base == indexOfName.end() ) {
+                break;
+            }
+            index = base->second;
+        }
+        return std::string_view( peripherals[index].groupName );
+    };
+
+    std::vector< bool > needed( peripherals.size(), false );
+    std::vector< std::size_t > pending;
+    auto require = [&]( std::string_view name ) {
+        auto it = indexOfName.find( name );
+        if( !name.empty() && it != indexOfName.end() && !needed[it->second] ) {
+            needed[it->second] = true;
+            pending.push_back( it->second );
+        }
+    };
+    for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+        if( filter.matches( peripherals[i].name, groupOf( i ) ) ) {
+            needed[i] = true;
+            pending.push_back( i );
+        }
+    }
+    while( !pending.empty() ) {
+        const Peripheral& peripheral = peripherals[pending.back()];
+        pending.pop_back();
+        require( peripheral.derivedFrom );
+        for( auto& registe : peripheral.getRegisters() ) {
+            require( peripheralOfPath( registe.derivedFrom, 1 ) );
+            for( auto& field : registe.fields ) {
+                require( peripheralOfPath( field.derivedFrom, 2 ) );
+            }
+        }
+    }
+    return needed;
+}
+
+} // namespace svd
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Peripheral.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace svd {
+
+// --only / --exclude filter. Patterns are names or globs and match either the
+// peripheral name or its groupName. Without --only every peripheral is
+// selected unless excluded.
+struct PeripheralFilter
+{
+    PeripheralFilter() = default;
+    PeripheralFilter( std::vector< std::string > only_, std::vector< std::string > exclude_ );
+    inline bool active() const
+    {
+        return !only.empty() || !exclude.empty();
+    }
+    bool matches( std::string_view name, std::string_view groupName ) const;
+
+private:
+    std::vector< std::string > only;
+    std::vector< std::string > exclude;
+};
+
+// Which peripherals are needed: the ones the filter matches plus, transitively,
+// every peripheral they reference through derivedFrom, including the
+// "PERIPH.REG" / "PERIPH.REG.FIELD" paths of registers and fields. A needed
+// base is kept even if it was excluded, its derived peripherals need it.
+// Derived peripherals without a groupName of their own match by their base's.
+// Peripherals whose registers weren't parsed yet only contribute their own
+// derivedFrom; parsers parse the newly needed ones and ask again until the
+// selection stops growing.
+std::vector< bool > selectPeripherals( const PeripheralFilter& filter, const std::vector< Peripheral >& peripherals );
+
+// Drops the peripherals (and their parallel entries) that aren't needed
+template< typename T >
+void keepSelected( std::vector< T >& items, const std::vector< bool >& needed )
+{
+    std::size_t kept = 0;
+    for( std::size_t i = 0; i < items.size(); ++i ) {
+        if( needed[i] ) {
+            if( kept != i ) {
+                items[kept] = std::move( items[i] );
+            }
+            ++kept;
+        }
+    }
+    items.resize( kept );
+}
+
+} // namespace svd
@@ -0,0 +1,201 @@
+#include "SplitFileBuilder.hpp"
+#include "Builders.hpp"
+#include "FileBuilder.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+const std::string commonHeader = "common.hpp";
+//What the parsers store for elements missing from the .svd file
+const std::string noValue = "Not found";
+
+struct Unit
+{
+    std::string name;
+    std::vector< std::string > includes;
+    std::vector< const PeripheralRecord* > peripherals;
+    // Unit that took over the peripherals to break an include cycle, this one
+    // only includes it then
+    std::size_t mergedInto;
+};
+
+// Strongly connected components of the include graph (Tarjan), every unit
+// maps to the first unit of its component
+std::vector< std::size_t > cyclesOf( const std::vector< std::vector< std::size_t > >& edges )
+{
+    const std::size_t unvisited = edges.size();
+    std::vector< std::size_t > index( edges.size(), unvisited ), low( edges.size() ), root( edges.size() );
+    std::vector< std::size_t > stack;
+    std::vector< bool > onStack( edges.size() );
+    std::size_t next = 0;
+    auto visit = [&]( auto& self, std::size_t unit ) -> void {
+        index[unit] = low[unit] = next++;
+        stack.push_back( unit );
+        onStack[unit] = true;
+        for( auto target : edges[unit] ) {
+            if( index[target] == unvisited ) {
+                self( self, target );
+                low[unit] = std::min( low[unit], low[target] );
+            }
+            else if( onStack[target] ) {
+                low[unit] = std::min( low[unit], index[target] );
+            }
+        }
+        if( low[unit] != index[unit] ) {
+            return;
+        }
+        const auto first = std::find( stack.begin(), stack.end(), unit );
+        const std::size_t firstUnit = *std::min_element( first, stack.end() );
+        for( auto it = first; it != stack.end(); ++it ) {
+            root[*it] = firstUnit;
+            onStack[*it] = false;
+        }
+        stack.erase( first, stack.end() );
+    };
+    for( std::size_t unit = 0; unit < edges.size(); ++unit ) {
+        if( index[unit] == unvisited ) {
+            visit( visit, unit );
+        }
+    }
+    return root;
+}
+
+} // namespace
+
+SplitFileBuilder::SplitFileBuilder( const DeviceModel& model_,
+    ESplitMode mode_,
+    EmitOptions emit_,
+    const PeripheralCache* cache_ )
+    : model( model_ )
+    , mode( mode_ )
+    , emit( std::move( emit_ ) )
+    , cache( cache_ )
+{
+}
+
+std::string SplitFileBuilder::unitOf( const PeripheralRecord& peripheral ) const
+{
+    const std::string_view groupName = model.str( peripheral.groupName );
+    if( mode == ESplitMode::Group && !groupName.empty() && groupName != noValue ) {
+        return std::string( groupName ) + ".hpp";
+    }
+    return std::string( model.str( peripheral.name ) ) + ".hpp";
+}
+
+void SplitFileBuilder::build( unsigned int jobs )
+{
+    const std::string_view deviceName = model.getDeviceInfo().name;
+    const std::string umbrellaHeader =
+        ( deviceName.empty() || deviceName == noValue ? std::string( "device" ) : std::string( deviceName ) ) + ".hpp";
+
+    //Assign peripherals to units, units are ordered by their first peripheral
+    std::vector< Unit > units;
+    std::unordered_map< std::string, std::size_t > unitIndex;
+    std::vector< std::size_t > unitOfPeripheral( model.getPeripherals().size() );
+    const std::vector< const PeripheralRecord* > order = emissionOrder( model );
+    for( auto peripheral : order ) {
+        const std::string name = unitOf( *peripheral );
+        if( name == commonHeader || name == umbrellaHeader ) {
+            throw std::runtime_error( "Peripheral header " + name + " collides with a generated header" );
+        }
+        auto [unit, isNew] = unitIndex.emplace( name, units.size() );
+        if( isNew ) {
+            units.push_back( { name, { commonHeader }, {}, units.size() } );
+        }
+        units[unit->second].peripherals.push_back( peripheral );
+        unitOfPeripheral[model.indexOf( *peripheral )] = unit->second;
+    }
+    //Aliases need the file holding the class they refer to. Units whose
+    //aliases refer to each other's classes, directly or around a longer
+    //cycle, are merged into the first of them.
+    std::vector< std::vector< std::size_t > > edges( units.size() );
+    for( std::size_t unit = 0; unit < units.size(); ++unit ) {
+        for( auto peripheral : units[unit].peripherals ) {
+            edges[unit].push_back( unitOfPeripheral[classOf( model, *peripheral, emit )] );
+        }
+    }
+    const std::vector< std::size_t > roots = cyclesOf( edges );
+    bool merged = false;
+    for( std::size_t unit = 0; unit < units.size(); ++unit ) {
+        if( roots[unit] != unit ) {
+            auto& target = units[roots[unit]].peripherals;
+            target.insert( target.end(), units[unit].peripherals.begin(), units[unit].peripherals.end() );
+            units[unit].peripherals.clear();
+            units[unit].includes = { units[roots[unit]].name };
+            units[unit].mergedInto = roots[unit];
+            merged = true;
+        }
+    }
+    if( merged ) {
+        std::vector< std::size_t > position( model.getPeripherals().size() );
+        for( std::size_t i = 0; i < order.size(); ++i ) {
+            position[model.indexOf( *order[i] )] = i;
+        }
+        for( std::size_t unit = 0; unit < units.size(); ++unit ) {
+            std::sort( units[unit].peripherals.begin(), units[unit].peripherals.end(),
+                [&]( auto lhs, auto rhs ) { return position[model.indexOf( *lhs )] < position[model.indexOf( *rhs )]; } );
+            for( auto peripheral : units[unit].peripherals ) {
+                unitOfPeripheral[model.indexOf( *peripheral )] = unit;
+            }
+        }
+    }
+    for( auto& unit : units ) {
+        for( auto peripheral : unit.peripherals ) {
+            const Unit& layoutUnit = units[unitOfPeripheral[classOf( model, *peripheral, emit )]];
+            if( &layoutUnit != &unit
+                && std::find( unit.includes.begin(), unit.includes.end(), layoutUnit.name ) == unit.includes.end() ) {
+                unit.includes.push_back( layoutUnit.name );
+            }
+        }
+    }
+
+    files.clear();
+    files.reserve( units.size() + 2 );
+    OutputFile& common = files.emplace_back();
+    common.name = commonHeader;
+    NSBeginBuilder().build( common.content );
+    FieldDefineBuilder().build( common.content );
+    for( std::uint32_t layout = 0; layout < model.getFieldLayouts().size(); ++layout ) {
+        FieldLayoutBuilder( model, layout ).build( common.content );
+    }
+    FunctionsBuilder().build( common.content );
+    NSEnduilder().build( common.content );
+
+    peripheralBytes.assign( model.getPeripherals().size(), 0 );
+    const std::size_t firstUnitFile = files.size();
+    files.resize( firstUnitFile + units.size() );
+    WorkerPool( jobs ).run( units.size(), [&]( std::size_t index ) {
+        const Unit& unit = units[index];
+        OutputFile& file = files[firstUnitFile + index];
+        file.name = unit.name;
+        if( unit.mergedInto != index ) {
+            file.content = "#pragma once\n#include \"" + units[unit.mergedInto].name + "\"";
+            return;
+        }
+        NSBeginBuilder( unit.includes ).build( file.content );
+        for( auto peripheral : unit.peripherals ) {
+            const std::size_t before = file.content.size();
+            if( cache ) {
+                CachedPeripheralBuilder( *cache, model.indexOf( *peripheral ) ).build( file.content );
+            }
+            else {
+                PeripheralBuilder( model, *peripheral, emit ).build( file.content );
+            }
+            peripheralBytes[model.indexOf( *peripheral )] = file.content.size() - before;
+        }
+        NSEnduilder().build( file.content );
+    } );
+
+    OutputFile& umbrella = files.emplace_back();
+    umbrella.name = umbrellaHeader;
+    umbrella.content = "#pragma once\n";
+    for( std::size_t unit = 0; unit < units.size(); ++unit ) {
+        if( units[unit].mergedInto == unit ) {
+            umbrella.content += "#include \"" + units[unit].name + "\"\n";
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Builders.hpp"
+#include "DeviceModel.hpp"
+#include "IBuilder.hpp"
+#include "PeripheralCache.hpp"
+
+#include <string>
+#include <vector>
+
+enum class ESplitMode
+{
+    Peripheral,
+    Group
+};
+
+struct OutputFile
+{
+    std::string name;
+    OutputSink content;
+};
+
+// Splits the header into one file per peripheral (or per groupName), a common
+// header with what they all need and an umbrella header named after the
+// device that includes everything, so users can include only what they use.
+struct SplitFileBuilder
+{
+    // With a cache, updated for the model, peripherals are copied from it
+    // instead of being emitted
+    SplitFileBuilder( const DeviceModel& model_,
+        ESplitMode mode_,
+        EmitOptions emit_ = {},
+        const PeripheralCache* cache_ = nullptr );
+    // Files are rendered on a WorkerPool when jobs > 1
+    void build( unsigned int jobs = 1 );
+    inline std::vector< OutputFile > takeFiles()
+    {
+        return std::move( files );
+    }
+    // Output bytes of every peripheral's class or alias, by model index
+    inline const std::vector< std::size_t >& getPeripheralBytes() const
+    {
+        return peripheralBytes;
+    }
+
+private:
+    std::string unitOf( const PeripheralRecord& peripheral ) const;
+
+private:
+    const DeviceModel& model;
+    const ESplitMode mode;
+    const EmitOptions emit;
+    const PeripheralCache* cache;
+    std::vector< OutputFile > files;
+    std::vector< std::size_t > peripheralBytes;
+};
@@ -0,0 +1,266 @@
+#include "Stats.hpp"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic< bool > counting{ false };
+std::atomic< std::uint64_t > allocations{ 0 };
+
+void count() noexcept
+{
+    if( counting.load( std::memory_order_relaxed ) ) {
+        allocations.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+void* countedAllocation( std::size_t size ) noexcept
+{
+    count();
+    return std::malloc( size == 0 ? 1 : size );
+}
+
+void* countedAllocation( std::size_t size, std::align_val_t alignment ) noexcept
+{
+    count();
+    //aligned_alloc wants a non-zero multiple of the alignment
+    const auto align = static_cast< std::size_t >( alignment );
+    return std::aligned_alloc( align, ( std::max< std::size_t >( size, 1 ) + align - 1 ) / align * align );
+}
+
+void* throwingAllocation( void* memory )
+{
+    if( !memory ) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+std::string jsonString( std::string_view text )
+{
+    std::string quoted = "\"";
+    for( char c : text ) {
+        if( c == '"' || c == '\\' ) {
+            quoted += '\\';
+        }
+        if( static_cast< unsigned char >( c ) < 0x20 ) {
+            fmt::format_to( std::back_inserter( quoted ), "\\u{:04x}", static_cast< unsigned int >( c ) );
+            continue;
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string jsonPhase( const PhaseStats& phase )
+{
+    return fmt::format( "{{ \"ms\": {:.3f}, \"allocations\": {} }}", phase.ms, phase.allocations );
+}
+
+} // namespace
+
+//Counting replacement of the whole family of global allocation functions:
+//plain, array, nothrow and aligned news and every matching delete. GCC takes
+//the free() of memory from a replaced operator new for a mismatch.
+#if defined( __GNUC__ ) && !defined( __clang__ )
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new( std::size_t size )
+{
+    return throwingAllocation( countedAllocation( size ) );
+}
+
+void* operator new[]( std::size_t size )
+{
+    return throwingAllocation( countedAllocation( size ) );
+}
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept
+{
+    return countedAllocation( size );
+}
+
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept
+{
+    return countedAllocation( size );
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment )
+{
+    return throwingAllocation( countedAllocation( size, alignment ) );
+}
+
+void* operator new[]( std::size_t size, std::align_val_t alignment )
+{
+    return throwingAllocation( countedAllocation( size, alignment ) );
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    return countedAllocation( size, alignment );
+}
+
+void* operator new[]( std::size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    return countedAllocation( size, alignment );
+}
+
+void operator delete( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, const std::nothrow_t& ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, const std::nothrow_t& ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    std::free( memory );
+}
+
+void countAllocations( bool enabled )
+{
+    counting.store( enabled, std::memory_order_relaxed );
+}
+
+std::uint64_t allocationCount()
+{
+    return allocations.load( std::memory_order_relaxed );
+}
+
+std::size_t peakRssKiB()
+{
+#ifdef __linux__
+    rusage usage{};
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+        return static_cast< std::size_t >( usage.ru_maxrss );
+    }
+#endif
+    return 0;
+}
+
+PhaseTimer::PhaseTimer()
+    : start( std::chrono::steady_clock::now() )
+    , allocationsAtStart( allocationCount() )
+{
+}
+
+PhaseStats PhaseTimer::stop() const
+{
+    PhaseStats phase;
+    phase.ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+    phase.allocations = allocationCount() - allocationsAtStart;
+    return phase;
+}
+
+PhaseStats PhaseTimer::stop( const PhaseStats& nested ) const
+{
+    PhaseStats phase = stop();
+    phase.ms -= nested.ms;
+    phase.allocations -= nested.allocations;
+    return phase;
+}
+
+void GenerationStats::log( spdlog::logger& logger ) const
+{
+    logger.info( "{}{}", input, cached ? " (cached)" : "" );
+    for( auto [name, phase] : { std::pair{ "load", &parser.load }, std::pair{ "parse", &parser.parse },
+             std::pair{ "derive", &parser.derive }, std::pair{ "emit", &emit }, std::pair{ "write", &write } } ) {
+        logger.info( "{:<7}{:>10.3f} ms {:>10} allocations", name, phase->ms, phase->allocations );
+    }
+    logger.info( "peak RSS {} KiB, {} allocations, {} output bytes", peakRssKiB, allocations, outputBytes );
+    for( auto& peripheral : peripherals ) {
+        logger.info( "{}: {} registers, {} fields, {} bytes", peripheral.name, peripheral.registers, peripheral.fields,
+            peripheral.outputBytes );
+    }
+}
+
+std::string GenerationStats::toJson() const
+{
+    std::string json;
+    auto it = std::back_inserter( json );
+    fmt::format_to( it,
+        "{{\n"
+        "  \"input\": {},\n"
+        "  \"cached\": {},\n"
+        "  \"phases\": {{\n"
+        "    \"load\": {},\n"
+        "    \"parse\": {},\n"
+        "    \"derive\": {},\n"
+        "    \"emit\": {},\n"
+        "    \"write\": {}\n"
+        "  }},\n"
+        "  \"peakRssKiB\": {},\n"
+        "  \"allocations\": {},\n"
+        "  \"outputBytes\": {},\n"
+        "  \"peripherals\": [",
+        jsonString( input ), cached, jsonPhase( parser.load ), jsonPhase( parser.parse ), jsonPhase( parser.derive ),
+        jsonPhase( emit ), jsonPhase( write ), peakRssKiB, allocations, outputBytes );
+    const char* separator = "\n";
+    for( auto& peripheral : peripherals ) {
+        fmt::format_to( it, "{}    {{ \"name\": {}, \"registers\": {}, \"fields\": {}, \"outputBytes\": {} }}", separator,
+            jsonString( peripheral.name ), peripheral.registers, peripheral.fields, peripheral.outputBytes );
+        separator = ",\n";
+    }
+    json += peripherals.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return json;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+class logger;
+}
+
+// Instrumentation behind --stats and --stats-json
+
+// Turns counting in the replaced operator new on, off by default so runs
+// without --stats pay a relaxed load per allocation and nothing more
+void countAllocations( bool enabled );
+// Heap allocations through operator new while counting was on
+std::uint64_t allocationCount();
+// Peak resident set size of the process in KiB, 0 where it isn't reported
+std::size_t peakRssKiB();
+
+// Wall time and heap allocations of one phase
+struct PhaseStats
+{
+    double ms = 0;
+    std::uint64_t allocations = 0;
+};
+
+// Measures from construction until stop()
+struct PhaseTimer
+{
+    PhaseTimer();
+    PhaseStats stop() const;
+    // Without a nested phase that was measured separately
+    PhaseStats stop( const PhaseStats& nested ) const;
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::uint64_t allocationsAtStart;
+};
+
+// Result of work(), with its time and allocations stored in phase
+template< typename F >
+auto measurePhase( PhaseStats& phase, F&& work ) -> decltype( work() )
+{
+    const PhaseTimer timer;
+    auto result = work();
+    phase = timer.stop();
+    return result;
+}
+
+// Phases of a parser: reading the file, parsing it into peripherals and
+// resolving derivedFrom
+struct ParsePhases
+{
+    PhaseStats load;
+    PhaseStats parse;
+    PhaseStats derive;
+};
+
+struct PeripheralStats
+{
+    std::string name;
+    std::uint32_t registers = 0;
+    std::uint32_t fields = 0;
+    // Bytes of the peripheral's class or alias in the output
+    std::size_t outputBytes = 0;
+};
+
+struct GenerationStats
+{
+    std::string input;
+    // Restored from the regeneration cache, only the write phase ran
+    bool cached = false;
+    ParsePhases parser;
+    PhaseStats emit;
+    PhaseStats write;
+    std::size_t peakRssKiB = 0;
+    std::uint64_t allocations = 0;
+    std::size_t outputBytes = 0;
+    std::vector< PeripheralStats > peripherals;
+
+    // One line per phase, a summary and one line per peripheral
+    void log( spdlog::logger& logger ) const;
+    std::string toJson() const;
+};
@@ -0,0 +1,524 @@
+#include "StreamParser.hpp"
+#include "DimArray.hpp"
+#include "InputFile.hpp"
+#include "SvdValues.hpp"
+#include "logging.h"
+
+#include <memory>
+#include <utility>
+
+namespace {
+
+std::string readFile( const std::string& inputFile, std::string& error )
+{
+    try {
+        return input::read( inputFile );
+    }
+    catch( const std::exception& ex ) {
+        error = ex.what();
+        return {};
+    }
+}
+
+// Mirrors FirstChildElement(): only the first occurrence of a child counts
+bool firstTime( unsigned int& seen, unsigned int bit )
+{
+    const bool first = ( seen & bit ) == 0;
+    seen |= bit;
+    return first;
+}
+
+bool isEndOrError( EXmlToken token )
+{
+    return token == EXmlToken::End || token == EXmlToken::Error;
+}
+
+} // namespace
+
+StreamParser::StreamParser( const std::string& inputFile, svd::PeripheralFilter filter_ )
+    : buffer( measurePhase( phases.load, [&] { return readFile( inputFile, error ); } ) )
+    , lexer( buffer )
+    , filter( std::move( filter_ ) )
+{
+}
+
+std::optional< std::string > StreamParser::isError() const
+{
+    if( !error.empty() ) {
+        return error;
+    }
+    return lexer.getError().empty() ? std::nullopt : std::optional< std::string >( lexer.getError() );
+}
+
+void StreamParser::parseXml()
+{
+    if( !error.empty() ) {
+        return;
+    }
+    const PhaseTimer timer;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        if( lexer.getName() == "device" ) {
+            parseDevice();
+        }
+        else {
+            lexer.skipElement();
+        }
+    }
+    phases.parse = timer.stop( phases.derive );
+}
+
+void StreamParser::parseDevice()
+{
+    //Set Schema Version
+    scratch.clear();
+    if( auto schemaVersion = lexer.attribute( "schemaVersion" ) ) {
+        XmlLexer::decode( *schemaVersion, scratch );
+    }
+    deviceInfo.schemaVersion = scratch;
+    deviceInfo.name = noValue;
+    deviceInfo.version = noValue;
+    deviceInfo.cpuName = noValue;
+    deviceInfo.resetValue = 0;
+
+    unsigned int seen = 0;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "name" && firstTime( seen, 1 << 0 ) ) {
+            readValue( deviceInfo.name );
+        }
+        else if( name == "version" && firstTime( seen, 1 << 1 ) ) {
+            readValue( deviceInfo.version );
+        }
+        else if( name == "peripherals" && firstTime( seen, 1 << 3 ) ) {
+            parsePeripherals();
+        }
+        else if( name == "cpu" && firstTime( seen, 1 << 4 ) ) {
+            parseCpu();
+        }
+        else if( !readRegisterDefault( name, deviceDefaults ) ) {
+            lexer.skipElement();
+        }
+    }
+    deviceInfo.resetValue = deviceDefaults.resetValue;
+    for( auto& peripheral : peripherals ) {
+        if( peripheral.registers ) {
+            svd::applyDefaults( *peripheral.registers, 0, deviceDefaults );
+        }
+    }
+}
+
+void StreamParser::parseCpu()
+{
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        if( lexer.getName() == "name" ) {
+            readValue( deviceInfo.cpuName );
+        }
+        else {
+            lexer.skipElement();
+        }
+    }
+}
+
+void StreamParser::parsePeripherals()
+{
+    std::vector< svd::PeripheralDerivations > derivations;
+    std::vector< std::size_t > offsets;
+    std::vector< bool > parsed;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        //Parse only "peripheral" node
+        if( lexer.getName() != "peripheral" ) {
+            logging::getLogger( "parser" ).warn( "Register node has value {}", lexer.getName() );
+            lexer.skipElement();
+            continue;
+        }
+        offsets.push_back( lexer.getOffset() );
+        bool complete = true;
+        peripherals.push_back( parsePeripheral( derivations.emplace_back(), filter.active(), complete ) );
+        parsed.push_back( complete );
+    }
+    if( filter.active() ) {
+        //Skipped peripherals that turn out to be needed are lexed again from
+        //their start tag, until nothing new is needed
+        std::vector< bool > needed;
+        for( bool grown = true; grown; ) {
+            needed = svd::selectPeripherals( filter, peripherals );
+            grown = false;
+            for( std::size_t i = 0; i < peripherals.size(); ++i ) {
+                if( needed[i] && !parsed[i] ) {
+                    reparsePeripheral( offsets[i], peripherals[i], derivations[i] );
+                    parsed[i] = grown = true;
+                }
+            }
+        }
+        svd::keepSelected( peripherals, needed );
+        svd::keepSelected( derivations, needed );
+    }
+    //Second pass, so derivedFrom may also name objects defined further down
+    const PhaseTimer deriveTimer;
+    svd::DerivationResolver::resolve( peripherals, derivations );
+    phases.derive = deriveTimer.stop();
+}
+
+void StreamParser::reparsePeripheral( std::size_t offset, Peripheral& peripheral, svd::PeripheralDerivations& derivations )
+{
+    XmlLexer peripheralLexer( std::string_view( buffer ).substr( offset ) );
+    std::swap( lexer, peripheralLexer );
+    lexer.next();
+    derivations = {};
+    bool complete = true;
+    peripheral = parsePeripheral( derivations, false, complete );
+    std::swap( lexer, peripheralLexer );
+}
+
+Peripheral StreamParser::parsePeripheral( svd::PeripheralDerivations& derivations, bool lazy, bool& complete )
+{
+    Peripheral peripheral;
+    readDerivedFrom( peripheral.derivedFrom );
+    peripheral.name = noValue;
+    peripheral.description = noValue;
+    peripheral.groupName = noValue;
+
+    //Seen elements double as what a derived peripheral specifies itself
+    unsigned int& seen = derivations.specified;
+    svd::RegisterDefaults defaults;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "name" && firstTime( seen, svd::PeripheralName ) ) {
+            readValue( peripheral.name );
+        }
+        else if( name == "baseAddress" && firstTime( seen, svd::PeripheralBaseAddress ) ) {
+            readValue( peripheral.baseAddress );
+        }
+        else if( name == "description" && firstTime( seen, svd::PeripheralDescription ) ) {
+            readValue( peripheral.description );
+        }
+        else if( name == "groupName" && firstTime( seen, svd::PeripheralGroupName ) ) {
+            readValue( peripheral.groupName );
+        }
+        else if( name == "addressBlock" && firstTime( seen, svd::PeripheralAddressBlock ) ) {
+            peripheral.addressBlock = parseAddressBlock();
+        }
+        else if( name == "registers" && firstTime( seen, svd::PeripheralRegisters ) ) {
+            if( lazy && !filter.matches( peripheral.name, peripheral.groupName ) ) {
+                //Parsed again later if something needs it after all
+                complete = false;
+                lexer.skipElement();
+                continue;
+            }
+            peripheral.registers = std::make_shared< RegisterList >();
+            parseRegisters( *peripheral.registers, derivations );
+        }
+        else if( !readRegisterDefault( name, defaults ) ) {
+            lexer.skipElement();
+        }
+    }
+    if( peripheral.registers ) {
+        svd::applyDefaults( *peripheral.registers, 0, defaults );
+    }
+    if( complete && peripheral.derivedFrom.empty() && ( seen & svd::PeripheralAddressBlock ) == 0 ) {
+        logging::getLogger( "parser" ).warn( "addressBlockRoot is nullptr" );
+    }
+    return peripheral;
+}
+
+AddressBlock StreamParser::parseAddressBlock()
+{
+    AddressBlock addressBlock;
+    unsigned int seen = 0;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "offset" && firstTime( seen, 1 << 0 ) ) {
+            readValue( addressBlock.offset );
+        }
+        else if( name == "size" && firstTime( seen, 1 << 1 ) ) {
+            readValue( addressBlock.size );
+        }
+        else {
+            lexer.skipElement();
+        }
+    }
+    return addressBlock;
+}
+
+void StreamParser::parseRegisters( RegisterList& registers, svd::PeripheralDerivations& derivations )
+{
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            return;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        if( lexer.getName() == "cluster" ) {
+            parseCluster( registers, derivations );
+            continue;
+        }
+        //Parse only "register" node
+        if( lexer.getName() != "register" ) {
+            logging::getLogger( "parser" ).warn( "Register node has value {}", lexer.getName() );
+            lexer.skipElement();
+            continue;
+        }
+        registers.push_back( parseRegister( derivations, registers.size() ) );
+    }
+}
+
+void StreamParser::parseCluster( RegisterList& registers, svd::PeripheralDerivations& derivations )
+{
+    svd::Cluster cluster;
+    if( auto derivedFrom = lexer.attribute( "derivedFrom" ) ) {
+        logging::getLogger( "parser" ).warn( "Cluster derivedFrom is not supported: {}", *derivedFrom );
+    }
+    cluster.name = noValue;
+    const std::size_t first = registers.size();
+    unsigned int seen = 0;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "register" ) {
+            registers.push_back( parseRegister( derivations, registers.size() ) );
+        }
+        else if( name == "cluster" ) {
+            parseCluster( registers, derivations );
+        }
+        else if( name == "name" && firstTime( seen, 1 << 0 ) ) {
+            readValue( cluster.name );
+        }
+        else if( name == "addressOffset" && firstTime( seen, 1 << 1 ) ) {
+            readValue( cluster.addressOffset );
+        }
+        else if( name == "dim" && firstTime( seen, 1 << 2 ) ) {
+            readValue( cluster.dim );
+        }
+        else if( name == "dimIncrement" && firstTime( seen, 1 << 3 ) ) {
+            readValue( cluster.dimIncrement );
+        }
+        else if( name == "dimIndex" && firstTime( seen, 1 << 4 ) ) {
+            readValue( cluster.dimIndex );
+        }
+        else if( !readRegisterDefault( name, cluster.defaults ) ) {
+            lexer.skipElement();
+        }
+    }
+    svd::flattenCluster( cluster, registers, first, derivations );
+}
+
+Register StreamParser::parseRegister( svd::PeripheralDerivations& derivations, std::size_t registerIndex )
+{
+    Register registe;
+    readDerivedFrom( registe.derivedFrom );
+    registe.name = noValue;
+    registe.description = noValue;
+    unsigned int seen = 0;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "name" && firstTime( seen, svd::RegisterName ) ) {
+            readValue( registe.name );
+        }
+        else if( name == "description" && firstTime( seen, svd::RegisterDescription ) ) {
+            readValue( registe.description );
+        }
+        else if( name == "addressOffset" && firstTime( seen, svd::RegisterAddressOffset ) ) {
+            readValue( registe.addressOffset );
+        }
+        else if( name == "size" && firstTime( seen, svd::RegisterSize ) ) {
+            readValue( registe.size );
+        }
+        else if( name == "access" && firstTime( seen, svd::RegisterAccess ) ) {
+            readValue( registe.registerAccess );
+        }
+        else if( name == "resetValue" && firstTime( seen, svd::RegisterResetValue ) ) {
+            readValue( registe.resetValue );
+        }
+        else if( name == "dim" && firstTime( seen, svd::RegisterDim ) ) {
+            readValue( registe.dim );
+        }
+        else if( name == "dimIncrement" && firstTime( seen, svd::RegisterDimIncrement ) ) {
+            readValue( registe.dimIncrement );
+        }
+        else if( name == "dimIndex" && firstTime( seen, svd::RegisterDimIndex ) ) {
+            readValue( registe.dimIndex );
+        }
+        else if( name == "fields" && firstTime( seen, svd::RegisterFields ) ) {
+            parseFields( registe.fields, derivations, registerIndex );
+        }
+        else {
+            lexer.skipElement();
+        }
+    }
+    if( !registe.derivedFrom.empty() ) {
+        derivations.registers.push_back( { registerIndex, seen } );
+    }
+    registe.specified = seen;
+    return registe;
+}
+
+void StreamParser::parseFields( std::vector< Field >& fields,
+    svd::PeripheralDerivations& derivations,
+    std::size_t registerIndex )
+{
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            return;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        //Parse only "field" node
+        if( lexer.getName() != "field" ) {
+            logging::getLogger( "parser" ).warn( "Field node has value {}", lexer.getName() );
+            lexer.skipElement();
+            continue;
+        }
+        unsigned int specified = 0;
+        fields.push_back( parseField( specified ) );
+        if( !fields.back().derivedFrom.empty() ) {
+            derivations.fields.push_back( { registerIndex, fields.size() - 1, specified } );
+        }
+    }
+}
+
+Field StreamParser::parseField( unsigned int& seen )
+{
+    Field field;
+    readDerivedFrom( field.derivedFrom );
+    field.name = noValue;
+    field.description = noValue;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token != EXmlToken::StartElement ) {
+            continue;
+        }
+        const std::string_view name = lexer.getName();
+        if( name == "name" && firstTime( seen, svd::FieldName ) ) {
+            readValue( field.name );
+        }
+        else if( name == "description" && firstTime( seen, svd::FieldDescription ) ) {
+            readValue( field.description );
+        }
+        else if( name == "bitOffset" && firstTime( seen, svd::FieldBitOffset ) ) {
+            readValue( field.bitOffset );
+        }
+        else if( name == "bitWidth" && firstTime( seen, svd::FieldBitWidth ) ) {
+            readValue( field.bitWidth );
+        }
+        else if( name == "access" && firstTime( seen, svd::FieldAccess ) ) {
+            readValue( field.fieldAccess );
+        }
+        else {
+            lexer.skipElement();
+        }
+    }
+    return field;
+}
+
+bool StreamParser::readRegisterDefault( std::string_view name, svd::RegisterDefaults& defaults )
+{
+    if( name == "size" && firstTime( defaults.specified, svd::RegisterSize ) ) {
+        readValue( defaults.size );
+    }
+    else if( name == "access" && firstTime( defaults.specified, svd::RegisterAccess ) ) {
+        readValue( defaults.access );
+    }
+    else if( name == "resetValue" && firstTime( defaults.specified, svd::RegisterResetValue ) ) {
+        readValue( defaults.resetValue );
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void StreamParser::readDerivedFrom( std::string& derivedFrom )
+{
+    derivedFrom.clear();
+    if( auto attribute = lexer.attribute( "derivedFrom" ) ) {
+        XmlLexer::decode( *attribute, derivedFrom );
+    }
+}
+
+std::string_view StreamParser::readText( std::string& decoded )
+{
+    //Like tinyxml2's GetText(): only a text node that is the first child counts
+    bool firstChild = true;
+    std::string_view text;
+    for( EXmlToken token = lexer.next(); !isEndOrError( token ); token = lexer.next() ) {
+        if( token == EXmlToken::EndElement ) {
+            break;
+        }
+        if( token == EXmlToken::Text && firstChild ) {
+            text = lexer.getText( decoded );
+        }
+        else if( token == EXmlToken::StartElement ) {
+            lexer.skipElement();
+        }
+        firstChild = false;
+    }
+    return text;
+}
+
+void StreamParser::readValue( std::string& field )
+{
+    field.assign( readText( scratch ) );
+}
+
+void StreamParser::readValue( unsigned int& field )
+{
+    field = svd::parseUnsigned( readText( scratch ) );
+}
+
+void StreamParser::readValue( std::uint64_t& field )
+{
+    field = svd::parseUnsigned64( readText( scratch ) );
+}
+
+void StreamParser::readValue( EAccess& field )
+{
+    svd::parseAccess( readText( scratch ), field );
+}
@@ -0,0 +1,84 @@
+#ifndef STREAM_PARSER
+#define STREAM_PARSER
+
+#include "Derivation.hpp"
+#include "DeviceInfo.hpp"
+#include "IParser.hpp"
+#include "Peripheral.hpp"
+#include "Selection.hpp"
+#include "XmlLexer.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single pass SVD parser that fills the model straight from an XmlLexer token
+// stream, without building a DOM. Produces the same model as XmlParser.
+struct StreamParser : public IParser
+{
+    // Registers of peripherals the filter doesn't select are skipped unparsed
+    // and only lexed again if a selected peripheral derives from them
+    StreamParser( const std::string& inputFile, svd::PeripheralFilter filter_ = {} );
+    std::optional< std::string > isError() const final;
+    void parseXml() final;
+    inline const DeviceInfo& getDeviceInfo() const final
+    {
+        return deviceInfo;
+    }
+    inline const std::vector< Peripheral >& getPeripherals() const final
+    {
+        return peripherals;
+    }
+    inline const ParsePhases& getPhases() const final
+    {
+        return phases;
+    }
+
+private:
+    void parseDevice();
+    void parseCpu();
+    void parsePeripherals();
+    // With lazy set, registers of a peripheral the filter doesn't match are
+    // skipped and complete is cleared
+    Peripheral parsePeripheral( svd::PeripheralDerivations& derivations, bool lazy, bool& complete );
+    // Parses the peripheral whose start tag is at offset with a fresh lexer
+    void reparsePeripheral( std::size_t offset, Peripheral& peripheral, svd::PeripheralDerivations& derivations );
+    AddressBlock parseAddressBlock();
+    void parseRegisters( RegisterList& registers, svd::PeripheralDerivations& derivations );
+    // Parses the cluster's registers into registers and flattens them
+    void parseCluster( RegisterList& registers, svd::PeripheralDerivations& derivations );
+    Register parseRegister( svd::PeripheralDerivations& derivations, std::size_t registerIndex );
+    void parseFields( std::vector< Field >& fields,
+        svd::PeripheralDerivations& derivations,
+        std::size_t registerIndex );
+    Field parseField( unsigned int& specified );
+    void readDerivedFrom( std::string& derivedFrom );
+    // Reads size, access or resetValue of a device, peripheral or cluster,
+    // false if name is none of them or was already read
+    bool readRegisterDefault( std::string_view name, svd::RegisterDefaults& defaults );
+
+    // Leaf readers consume the element whose StartElement was just read
+    // The returned text is a view into the document or into decoded
+    std::string_view readText( std::string& decoded );
+    void readValue( std::string& field );
+    void readValue( unsigned int& field );
+    void readValue( std::uint64_t& field );
+    void readValue( EAccess& field );
+
+private:
+    // Declared before buffer, reading the file sets them
+    ParsePhases phases;
+    std::string error;
+    std::string buffer;
+    XmlLexer lexer;
+    const svd::PeripheralFilter filter;
+    std::string scratch;
+    static const inline std::string noValue = "Not found";
+    DeviceInfo deviceInfo;
+    // Register defaults of the device level, applied after the peripheral level
+    svd::RegisterDefaults deviceDefaults;
+    std::vector< Peripheral > peripherals;
+};
+
+#endif
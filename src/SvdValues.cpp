@@ -0,0 +1,124 @@
+#include "SvdValues.hpp"
+#include "logging.h"
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+std::string_view trim( std::string_view text )
+{
+    const auto begin = text.find_first_not_of( " \t\r\n" );
+    if( begin == std::string_view::npos ) {
+        return {};
+    }
+    return text.substr( begin, text.find_last_not_of( " \t\r\n" ) - begin + 1 );
+}
+
+} // namespace
+
+namespace svd {
+
+bool parseScaledInteger( std::string_view text, std::uint64_t& value )
+{
+    text = trim( text );
+    if( !text.empty() && text.front() == '+' ) {
+        text.remove_prefix( 1 );
+    }
+
+    int base = 10;
+    if( text.size() > 2 && text[0] == '0' && ( text[1] == 'x' || text[1] == 'X' ) ) {
+        base = 16;
+        text.remove_prefix( 2 );
+    }
+    else if( text.size() > 2 && text[0] == '0' && ( text[1] == 'b' || text[1] == 'B' ) ) {
+        base = 2;
+        text.remove_prefix( 2 );
+    }
+    else if( text.size() > 1 && text[0] == '#' ) {
+        base = 2;
+        text.remove_prefix( 1 );
+    }
+
+    //Optional scale suffix: k, M, G or T (powers of 1024)
+    unsigned int shift = 0;
+    if( !text.empty() ) {
+        switch( text.back() ) {
+        case 'k':
+        case 'K':
+            shift = 10;
+            break;
+        case 'm':
+        case 'M':
+            shift = 20;
+            break;
+        case 'g':
+        case 'G':
+            shift = 30;
+            break;
+        case 't':
+        case 'T':
+            shift = 40;
+            break;
+        default:
+            break;
+        }
+        if( shift != 0 ) {
+            text.remove_suffix( 1 );
+        }
+    }
+
+    std::uint64_t parsed = 0;
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars( text.data(), end, parsed, base );
+    if( text.empty() || ec != std::errc() || ptr != end ) {
+        return false;
+    }
+    if( shift != 0 && parsed > ( std::numeric_limits< std::uint64_t >::max() >> shift ) ) {
+        return false;
+    }
+    value = parsed << shift;
+    return true;
+}
+
+unsigned int parseUnsigned( std::string_view text )
+{
+    std::uint64_t value = 0;
+    if( !parseScaledInteger( text, value ) || value > std::numeric_limits< unsigned int >::max() ) {
+        logging::getLogger( "parser" ).warn( "Wrong number: {}", text );
+        return 0;
+    }
+    return static_cast< unsigned int >( value );
+}
+
+std::uint64_t parseUnsigned64( std::string_view text )
+{
+    std::uint64_t value = 0;
+    if( !parseScaledInteger( text, value ) ) {
+        logging::getLogger( "parser" ).warn( "Wrong number: {}", text );
+        return 0;
+    }
+    return value;
+}
+
+bool parseAccess( std::string_view text, EAccess& access )
+{
+    text = trim( text );
+    if( text == "read-only" ) {
+        access = EAccess::Read_Only;
+    }
+    else if( text == "write-only" || text == "writeOnce" ) {
+        access = EAccess::Write_Only;
+    }
+    else if( text == "read-write" || text == "read-writeOnce" ) {
+        access = EAccess::Read_Write;
+    }
+    else {
+        logging::getLogger( "parser" ).warn( "Wrong field for access: {}", text );
+        return false;
+    }
+    return true;
+}
+
+} // namespace svd
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Peripheral.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+// Conversions of SVD element text shared by all parser backends, so every
+// backend produces the same model from the same document.
+namespace svd {
+
+// scaledNonNegativeInteger: decimal, 0x/0X hex, #/0b binary, optional '+' and
+// k/M/G/T suffix. Returns false on malformed text or overflow.
+bool parseScaledInteger( std::string_view text, std::uint64_t& value );
+// Reports malformed text and yields 0 instead of throwing
+unsigned int parseUnsigned( std::string_view text );
+// Same for 64-bit values such as resetValue
+std::uint64_t parseUnsigned64( std::string_view text );
+// Leaves access untouched and returns false on unknown text
+bool parseAccess( std::string_view text, EAccess& access );
+
+} // namespace svd
@@ -0,0 +1,106 @@
+#include "Watcher.hpp"
+#include "Generator.hpp"
+#include "InputFile.hpp"
+#include "logging.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Editors save in several steps, events closer than this are one change
+constexpr int settleMs = 50;
+
+// Waits up to timeoutMs (-1 without limit) for events of the watched
+// directory, true if one of them was about the file name
+bool inputChanged( int fd, const std::string& name, int timeoutMs )
+{
+    pollfd watched{ fd, POLLIN, 0 };
+    const int ready = poll( &watched, 1, timeoutMs );
+    if( ready < 0 ) {
+        throw std::runtime_error( "Waiting for changes failed" );
+    }
+    if( ready == 0 ) {
+        return false;
+    }
+    alignas( inotify_event ) char buffer[4096];
+    const ssize_t length = read( fd, buffer, sizeof( buffer ) );
+    if( length <= 0 ) {
+        throw std::runtime_error( "Reading file events failed" );
+    }
+    bool changed = false;
+    for( ssize_t offset = 0; offset < length; ) {
+        const auto* event = reinterpret_cast< const inotify_event* >( buffer + offset );
+        changed = changed || ( event->len > 0 && name == event->name );
+        offset += static_cast< ssize_t >( sizeof( inotify_event ) + event->len );
+    }
+    return changed;
+}
+#endif
+
+} // namespace
+
+Watcher::Watcher( const cxxopts::ParseResult& options_, unsigned int jobs_ )
+    : options( options_ )
+    , jobs( jobs_ )
+{
+}
+
+void Watcher::generate( const std::string& inputFile, const std::string& outputFile )
+{
+    auto& logger = logging::getLogger( "watch" );
+    const GenerationResult result = Generator( options, jobs, &cache ).run( inputFile, outputFile );
+    if( !result.ok() ) {
+        logger.error( "{}", result.message );
+        return;
+    }
+    if( result.cached ) {
+        logger.info( "Restored {} from the cache in {:.1f} ms", outputFile, result.totalMs() );
+        return;
+    }
+    logger.info( "Generated {} in {:.1f} ms (parse {:.1f} ms), {} of {} peripherals emitted", outputFile,
+        result.totalMs(), result.parseMs, cache.getRebuilt(), cache.size() );
+}
+
+int Watcher::run( const std::string& inputFile, const std::string& outputFile )
+{
+    auto& logger = logging::getLogger( "watch" );
+    generate( inputFile, outputFile );
+#ifdef __linux__
+    const int fd = inotify_init1( IN_CLOEXEC );
+    //Editors often replace the file instead of writing to it, so its
+    //directory is watched
+    const std::filesystem::path input = input::fileOf( inputFile );
+    const std::filesystem::path directory = input.has_parent_path() ? input.parent_path() : ".";
+    if( fd < 0 || inotify_add_watch( fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE ) < 0 ) {
+        logger.error( "Can't watch {}", directory.string() );
+        return 2;
+    }
+    logger.info( "Watching {}", inputFile );
+    try {
+        const std::string name = input.filename().string();
+        for( ;; ) {
+            while( !inputChanged( fd, name, -1 ) ) {
+            }
+            while( inputChanged( fd, name, settleMs ) ) {
+            }
+            generate( inputFile, outputFile );
+        }
+    }
+    catch( const std::exception& ex ) {
+        logger.error( "{}", ex.what() );
+    }
+    close( fd );
+    return 2;
+#else
+    logger.error( "--watch needs inotify, which is only available on Linux" );
+    return 2;
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "PeripheralCache.hpp"
+
+#include <cxxopts.hpp>
+
+#include <string>
+
+// --watch: generates the outputs, then regenerates them whenever the input
+// file changes. Peripherals are emitted again only if they changed, see
+// PeripheralCache, and only files whose content changed are rewritten.
+struct Watcher
+{
+    Watcher( const cxxopts::ParseResult& options_, unsigned int jobs_ );
+    // Runs until the process is stopped, returns only if the input can't be
+    // watched
+    int run( const std::string& inputFile, const std::string& outputFile );
+
+private:
+    void generate( const std::string& inputFile, const std::string& outputFile );
+
+private:
+    const cxxopts::ParseResult& options;
+    const unsigned int jobs;
+    PeripheralCache cache;
+};
@@ -0,0 +1,45 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+WorkerPool::WorkerPool( unsigned int jobs_ )
+    : jobs( jobs_ == 0 ? defaultJobs() : jobs_ )
+{
+}
+
+void WorkerPool::run( std::size_t taskCount, const std::function< void( std::size_t ) >& task ) const
+{
+    const std::size_t threadCount = std::min< std::size_t >( jobs, taskCount );
+    if( threadCount <= 1 ) {
+        for( std::size_t i = 0; i < taskCount; ++i ) {
+            task( i );
+        }
+        return;
+    }
+
+    std::atomic< std::size_t > next{ 0 };
+    auto worker = [&]() {
+        for( std::size_t i = next++; i < taskCount; i = next++ ) {
+            task( i );
+        }
+    };
+    std::vector< std::thread > threads;
+    threads.reserve( threadCount - 1 );
+    for( std::size_t i = 1; i < threadCount; ++i ) {
+        threads.emplace_back( worker );
+    }
+    // The calling thread works too instead of idling in join()
+    worker();
+    for( auto& thread : threads ) {
+        thread.join();
+    }
+}
+
+unsigned int WorkerPool::defaultJobs()
+{
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Fixed-size pool of worker threads pulling task indices from a shared counter.
+// Tasks must not throw; callers capture their own errors.
+struct WorkerPool
+{
+    explicit WorkerPool( unsigned int jobs_ = 0 );
+    void run( std::size_t taskCount, const std::function< void( std::size_t ) >& task ) const;
+    inline unsigned int getJobs() const
+    {
+        return jobs;
+    }
+    static unsigned int defaultJobs();
+
+private:
+    unsigned int jobs;
+};
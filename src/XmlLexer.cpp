@@ -0,0 +1,342 @@
+#include "XmlLexer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+inline bool isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isNameChar( char c )
+{
+    return !isSpace( c ) && c != '>' && c != '/' && c != '=' && c != '<' && c != '"' && c != '\'';
+}
+
+void appendUtf8( std::uint32_t code, std::string& out )
+{
+    if( code < 0x80 ) {
+        out += static_cast< char >( code );
+    }
+    else if( code < 0x800 ) {
+        out += static_cast< char >( 0xC0 | ( code >> 6 ) );
+        out += static_cast< char >( 0x80 | ( code & 0x3F ) );
+    }
+    else if( code < 0x10000 ) {
+        out += static_cast< char >( 0xE0 | ( code >> 12 ) );
+        out += static_cast< char >( 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        out += static_cast< char >( 0x80 | ( code & 0x3F ) );
+    }
+    else {
+        out += static_cast< char >( 0xF0 | ( code >> 18 ) );
+        out += static_cast< char >( 0x80 | ( ( code >> 12 ) & 0x3F ) );
+        out += static_cast< char >( 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        out += static_cast< char >( 0x80 | ( code & 0x3F ) );
+    }
+}
+
+// Decodes the entity starting at raw[0] == '&'; returns consumed length or 0 if unknown
+std::size_t decodeEntity( std::string_view raw, std::string& out )
+{
+    const std::size_t end = raw.find( ';' );
+    if( end == std::string_view::npos || end < 2 ) {
+        return 0;
+    }
+    const std::string_view entity = raw.substr( 1, end - 1 );
+    if( entity[0] == '#' ) {
+        const bool hex = entity.size() > 1 && ( entity[1] == 'x' || entity[1] == 'X' );
+        std::uint32_t code = 0;
+        std::size_t i = hex ? 2 : 1;
+        if( i == entity.size() ) {
+            return 0;
+        }
+        for( ; i < entity.size(); ++i ) {
+            const char c = entity[i];
+            std::uint32_t digit;
+            if( c >= '0' && c <= '9' ) {
+                digit = c - '0';
+            }
+            else if( hex && c >= 'a' && c <= 'f' ) {
+                digit = c - 'a' + 10;
+            }
+            else if( hex && c >= 'A' && c <= 'F' ) {
+                digit = c - 'A' + 10;
+            }
+            else {
+                return 0;
+            }
+            code = code * ( hex ? 16 : 10 ) + digit;
+            if( code > 0x10FFFF ) {
+                return 0;
+            }
+        }
+        appendUtf8( code, out );
+        return end + 1;
+    }
+    static constexpr std::pair< std::string_view, char > named[] = {
+        { "lt", '<' }, { "gt", '>' }, { "amp", '&' }, { "quot", '"' }, { "apos", '\'' } };
+    for( auto& [entityName, value] : named ) {
+        if( entity == entityName ) {
+            out += value;
+            return end + 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+XmlLexer::XmlLexer( std::string_view buffer_ )
+    : buffer( buffer_ )
+{
+    openElements.reserve( 16 );
+    //Skip UTF-8 BOM
+    if( buffer.substr( 0, 3 ) == "\xEF\xBB\xBF" ) {
+        pos = 3;
+    }
+}
+
+EXmlToken XmlLexer::next()
+{
+    if( !error.empty() ) {
+        return EXmlToken::Error;
+    }
+    if( pendingEnd ) {
+        //Second half of an empty element tag "<name/>"
+        pendingEnd = false;
+        openElements.pop_back();
+        return EXmlToken::EndElement;
+    }
+    for( ;; ) {
+        tokenBegin = pos;
+        if( pos >= buffer.size() ) {
+            if( !openElements.empty() ) {
+                return fail( "Unexpected end of document, element is not closed" );
+            }
+            return EXmlToken::End;
+        }
+        if( buffer[pos] == '<' ) {
+            return lexTag();
+        }
+        const std::size_t end = std::min( buffer.find( '<', pos ), buffer.size() );
+        const std::string_view run = buffer.substr( pos, end - pos );
+        pos = end;
+        if( std::all_of( run.begin(), run.end(), isSpace ) ) {
+            continue;
+        }
+        if( openElements.empty() ) {
+            return fail( "Text outside of the root element" );
+        }
+        text = run;
+        cdata = false;
+        return EXmlToken::Text;
+    }
+}
+
+EXmlToken XmlLexer::lexTag()
+{
+    const std::string_view rest = buffer.substr( pos );
+    auto skipTo = [&]( std::string_view terminator, const char* message ) {
+        const std::size_t end = buffer.find( terminator, pos );
+        if( end == std::string_view::npos ) {
+            return fail( message );
+        }
+        pos = end + terminator.size();
+        return EXmlToken::Misc;
+    };
+    if( rest.substr( 0, 4 ) == "<!--" ) {
+        return skipTo( "-->", "Unterminated comment" );
+    }
+    if( rest.substr( 0, 9 ) == "<![CDATA[" ) {
+        const std::size_t end = buffer.find( "]]>", pos + 9 );
+        if( end == std::string_view::npos ) {
+            return fail( "Unterminated CDATA section" );
+        }
+        if( openElements.empty() ) {
+            return fail( "CDATA outside of the root element" );
+        }
+        text = buffer.substr( pos + 9, end - pos - 9 );
+        cdata = true;
+        pos = end + 3;
+        return EXmlToken::Text;
+    }
+    if( rest.substr( 0, 2 ) == "<?" ) {
+        return skipTo( "?>", "Unterminated processing instruction" );
+    }
+    if( rest.substr( 0, 2 ) == "<!" ) {
+        //DOCTYPE may carry an internal subset in brackets
+        int brackets = 0;
+        for( std::size_t i = pos + 2; i < buffer.size(); ++i ) {
+            if( buffer[i] == '[' ) {
+                ++brackets;
+            }
+            else if( buffer[i] == ']' ) {
+                --brackets;
+            }
+            else if( buffer[i] == '>' && brackets <= 0 ) {
+                pos = i + 1;
+                return EXmlToken::Misc;
+            }
+        }
+        return fail( "Unterminated declaration" );
+    }
+
+    const bool closing = rest.size() > 1 && rest[1] == '/';
+    std::size_t i = pos + ( closing ? 2 : 1 );
+    const std::size_t nameBegin = i;
+    while( i < buffer.size() && isNameChar( buffer[i] ) ) {
+        ++i;
+    }
+    name = buffer.substr( nameBegin, i - nameBegin );
+    if( name.empty() ) {
+        return fail( "Element without a name" );
+    }
+
+    if( closing ) {
+        while( i < buffer.size() && isSpace( buffer[i] ) ) {
+            ++i;
+        }
+        if( i >= buffer.size() || buffer[i] != '>' ) {
+            return fail( "Malformed closing tag" );
+        }
+        if( openElements.empty() || openElements.back() != name ) {
+            return fail( "Mismatched closing tag" );
+        }
+        openElements.pop_back();
+        pos = i + 1;
+        return EXmlToken::EndElement;
+    }
+
+    //Find the end of the start tag, honoring quoted attribute values
+    const std::size_t attributesBegin = i;
+    char quote = 0;
+    for( ; i < buffer.size(); ++i ) {
+        const char c = buffer[i];
+        if( quote ) {
+            quote = c == quote ? 0 : quote;
+        }
+        else if( c == '"' || c == '\'' ) {
+            quote = c;
+        }
+        else if( c == '>' || c == '<' ) {
+            break;
+        }
+    }
+    if( i >= buffer.size() || buffer[i] != '>' ) {
+        return fail( "Malformed start tag" );
+    }
+    const bool empty = buffer[i - 1] == '/' && i - 1 >= attributesBegin;
+    attributes = buffer.substr( attributesBegin, i - attributesBegin - ( empty ? 1 : 0 ) );
+    pos = i + 1;
+    openElements.push_back( name );
+    pendingEnd = empty;
+    return EXmlToken::StartElement;
+}
+
+EXmlToken XmlLexer::skipElement()
+{
+    const std::size_t depth = openElements.size();
+    for( ;; ) {
+        const EXmlToken token = next();
+        if( token == EXmlToken::Error || token == EXmlToken::End
+            || ( token == EXmlToken::EndElement && openElements.size() < depth ) ) {
+            return token;
+        }
+    }
+}
+
+std::optional< std::string_view > XmlLexer::attribute( std::string_view attributeName ) const
+{
+    std::size_t i = 0;
+    while( i < attributes.size() ) {
+        while( i < attributes.size() && isSpace( attributes[i] ) ) {
+            ++i;
+        }
+        const std::size_t nameBegin = i;
+        while( i < attributes.size() && isNameChar( attributes[i] ) ) {
+            ++i;
+        }
+        const std::string_view current = attributes.substr( nameBegin, i - nameBegin );
+        while( i < attributes.size() && ( isSpace( attributes[i] ) || attributes[i] == '=' ) ) {
+            ++i;
+        }
+        if( current.empty() || i >= attributes.size() || ( attributes[i] != '"' && attributes[i] != '\'' ) ) {
+            return std::nullopt;
+        }
+        const std::size_t valueEnd = attributes.find( attributes[i], i + 1 );
+        if( valueEnd == std::string_view::npos ) {
+            return std::nullopt;
+        }
+        if( current == attributeName ) {
+            return attributes.substr( i + 1, valueEnd - i - 1 );
+        }
+        i = valueEnd + 1;
+    }
+    return std::nullopt;
+}
+
+std::string_view XmlLexer::getText( std::string& scratch ) const
+{
+    if( text.find_first_of( cdata ? "\r" : "&\r" ) == std::string_view::npos ) {
+        return text;
+    }
+    std::string& out = scratch;
+    out.clear();
+    if( cdata ) {
+        //No entities in CDATA, only newline normalization
+        for( std::size_t i = 0; i < text.size(); ++i ) {
+            if( text[i] == '\r' ) {
+                out += '\n';
+                i += i + 1 < text.size() && text[i + 1] == '\n' ? 1 : 0;
+            }
+            else {
+                out += text[i];
+            }
+        }
+        return out;
+    }
+    decode( text, out );
+    return out;
+}
+
+void XmlLexer::decode( std::string_view raw, std::string& out )
+{
+    out.clear();
+    out.reserve( raw.size() );
+    for( std::size_t i = 0; i < raw.size(); ) {
+        const std::size_t special = raw.find_first_of( "&\r", i );
+        out.append( raw.substr( i, special - i ) );
+        if( special == std::string_view::npos ) {
+            return;
+        }
+        i = special;
+        if( raw[i] == '\r' ) {
+            out += '\n';
+            i += i + 1 < raw.size() && raw[i + 1] == '\n' ? 2 : 1;
+            continue;
+        }
+        const std::size_t consumed = decodeEntity( raw.substr( i ), out );
+        if( consumed == 0 ) {
+            //Unknown entities are kept verbatim
+            out += '&';
+            ++i;
+        }
+        else {
+            i += consumed;
+        }
+    }
+}
+
+EXmlToken XmlLexer::fail( const char* message )
+{
+    error = std::string( message ) + " at line " + std::to_string( lineAt( tokenBegin ) );
+    return EXmlToken::Error;
+}
+
+std::size_t XmlLexer::lineAt( std::size_t offset ) const
+{
+    const std::string_view head = buffer.substr( 0, offset );
+    return 1 + std::count( head.begin(), head.end(), '\n' );
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class EXmlToken
+{
+    StartElement,
+    EndElement,
+    Text,
+    Misc, // comment, declaration, processing instruction or DOCTYPE
+    End,
+    Error
+};
+
+// Pull lexer over an in-memory XML document. Names, attribute values and text
+// are views into the buffer; entities are only decoded on request. Text follows
+// tinyxml2's rules: whitespace-only runs between tags are dropped, anything else
+// is reported verbatim.
+struct XmlLexer
+{
+    XmlLexer( std::string_view buffer_ );
+    EXmlToken next();
+    // Skips the remainder of the element whose StartElement was just returned
+    EXmlToken skipElement();
+
+    // Element name for StartElement and EndElement tokens
+    inline std::string_view getName() const
+    {
+        return name;
+    }
+    // Undecoded content of a Text token
+    inline std::string_view getRawText() const
+    {
+        return text;
+    }
+    inline bool isCData() const
+    {
+        return cdata;
+    }
+    // Undecoded attribute value of the current StartElement
+    std::optional< std::string_view > attribute( std::string_view attributeName ) const;
+    // Text with entities replaced and newlines normalized. Views straight into
+    // the document when nothing needs decoding, otherwise into scratch.
+    std::string_view getText( std::string& scratch ) const;
+    static void decode( std::string_view raw, std::string& out );
+
+    inline std::size_t getOffset() const
+    {
+        return tokenBegin;
+    }
+    inline std::size_t getDepth() const
+    {
+        return openElements.size();
+    }
+    inline const std::string& getError() const
+    {
+        return error;
+    }
+
+private:
+    EXmlToken fail( const char* message );
+    EXmlToken lexTag();
+    std::size_t lineAt( std::size_t offset ) const;
+
+private:
+    std::string_view buffer;
+    std::size_t pos = 0;
+    std::size_t tokenBegin = 0;
+    std::string_view name;
+    std::string_view text;
+    std::string_view attributes;
+    bool cdata = false;
+    bool pendingEnd = false;
+    std::vector< std::string_view > openElements;
+    std::string error;
+};
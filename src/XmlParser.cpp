@@ -1,144 +1,222 @@
 #include "XmlParser.hpp"
+#include "DimArray.hpp"
+#include "InputFile.hpp"
+#include "SvdValues.hpp"
+#include "WorkerPool.hpp"
+#include "logging.h"
 
-#include <algorithm>
-#include <iostream>
+#include <memory>
+#include <string_view>
 
-XmlParser::XmlParser( const std::string& inputFile )
+namespace {
+
+// GetText() is nullptr for empty elements
+const char* textOf( const tinyxml2::XMLElement* element )
+{
+    const char* text = element->GetText();
+    return text ? text : "";
+}
+
+} // namespace
+
+XmlParser::XmlParser( const std::string& inputFile, unsigned int jobs_, svd::PeripheralFilter filter_ )
+    : jobs( jobs_ )
+    , filter( std::move( filter_ ) )
 {
-    xmlDocument.LoadFile( inputFile.c_str() );
+    const PhaseTimer timer;
+    if( !input::isPacked( inputFile ) ) {
+        xmlDocument.LoadFile( inputFile.c_str() );
+    }
+    else {
+        try {
+            const std::string content = input::read( inputFile );
+            xmlDocument.Parse( content.data(), content.size() );
+        }
+        catch( const std::exception& ex ) {
+            loadError = ex.what();
+        }
+    }
+    phases.load = timer.stop();
 }
 std::optional< std::string > XmlParser::isError() const
 {
+    if( !loadError.empty() ) {
+        return loadError;
+    }
     return xmlDocument.Error() ? std::optional< std::string >( xmlDocument.ErrorStr() ) : std::nullopt;
 }
 
 void XmlParser::parseXml()
 {
+    const PhaseTimer timer;
     tinyxml2::XMLElement* deviceRoot = xmlDocument.FirstChildElement( "device" );
     if( deviceRoot == nullptr )
         return;
     //Set Schema Version
-    deviceInfo.schemaVersion = deviceRoot->Attribute( "schemaVersion" );
+    const char* schemaVersion = deviceRoot->Attribute( "schemaVersion" );
+    deviceInfo.schemaVersion = schemaVersion ? schemaVersion : "";
 
     //Set attributes
     setDeviceInfoAttrib( deviceRoot, "name", deviceInfo.name );
     setDeviceInfoAttrib( deviceRoot, "version", deviceInfo.version );
     setDeviceInfoAttrib( deviceRoot, "resetValue", deviceInfo.resetValue );
+    if( tinyxml2::XMLElement* cpuRoot = deviceRoot->FirstChildElement( "cpu" ) ) {
+        setDeviceInfoAttrib( cpuRoot, "name", deviceInfo.cpuName );
+    }
+    else {
+        deviceInfo.cpuName = noValue;
+    }
+    const svd::RegisterDefaults deviceDefaults = parseRegisterDefaults( deviceRoot );
 
     // deviceInfo.printDeviceInfo();
 
     //Iterate over all peripherals and append them to peripherals
     tinyxml2::XMLElement* peripheralsRoot = deviceRoot->FirstChildElement( "peripherals" );
+    std::vector< tinyxml2::XMLElement* > peripheralRoots;
     if( peripheralsRoot != nullptr ) {
-        for( tinyxml2::XMLNode* peripheralRoot = peripheralsRoot->FirstChild(); peripheralRoot;
-             peripheralRoot = peripheralRoot->NextSibling() ) {
+        for( tinyxml2::XMLElement* peripheralRoot = peripheralsRoot->FirstChildElement(); peripheralRoot;
+             peripheralRoot = peripheralRoot->NextSiblingElement() ) {
             //Parse only "peripheral" node
-            if( std::string( peripheralRoot->Value() ) != "peripheral" ) {
-                std::cout << "Register node has value " << peripheralRoot->Value();
+            if( std::string_view( peripheralRoot->Name() ) != "peripheral" ) {
+                logging::getLogger( "parser" ).warn( "Register node has value {}", peripheralRoot->Name() );
                 continue;
             }
-            peripherals.push_back( parsePeripheral( peripheralRoot->ToElement() ) );
+            peripheralRoots.push_back( peripheralRoot );
         }
     }
+    //Subtrees are disjoint and only derivedFrom links them, which is resolved
+    //afterwards, so they can be parsed in any order into their own slots
+    peripherals.resize( peripheralRoots.size() );
+    std::vector< svd::PeripheralDerivations > derivations( peripheralRoots.size() );
+    std::vector< bool > needed( peripheralRoots.size(), true ), parsed( peripheralRoots.size(), false );
+    if( filter.active() ) {
+        for( std::size_t i = 0; i < peripheralRoots.size(); ++i ) {
+            peripherals[i] = parsePeripheralHeader( peripheralRoots[i] );
+        }
+    }
+    //Parsed peripherals may reference more peripherals, repeat until nothing new is needed
+    for( ;; ) {
+        if( filter.active() ) {
+            needed = svd::selectPeripherals( filter, peripherals );
+        }
+        std::vector< std::size_t > toParse;
+        for( std::size_t i = 0; i < peripheralRoots.size(); ++i ) {
+            if( needed[i] && !parsed[i] ) {
+                toParse.push_back( i );
+                parsed[i] = true;
+            }
+        }
+        if( toParse.empty() ) {
+            break;
+        }
+        WorkerPool( jobs ).run( toParse.size(), [&]( std::size_t task ) {
+            const std::size_t index = toParse[task];
+            peripherals[index] = parsePeripheral( peripheralRoots[index], derivations[index] );
+        } );
+    }
+    svd::keepSelected( peripherals, needed );
+    svd::keepSelected( derivations, needed );
+    //Second pass, so derivedFrom may also name objects defined further down
+    const PhaseTimer deriveTimer;
+    svd::DerivationResolver::resolve( peripherals, derivations );
+    phases.derive = deriveTimer.stop();
+    for( auto& peripheral : peripherals ) {
+        if( peripheral.registers ) {
+            svd::applyDefaults( *peripheral.registers, 0, deviceDefaults );
+        }
+    }
+    phases.parse = timer.stop( phases.derive );
 }
 
-void XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
+bool XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
     const char* name,
     std::string& field ) const
 {
     tinyxml2::XMLElement* deviceEntry = deviceRoot->FirstChildElement( name );
-    field = deviceEntry ? std::string( deviceEntry->GetText() ) : noValue;
+    field = deviceEntry ? textOf( deviceEntry ) : noValue;
+    return deviceEntry != nullptr;
 }
 
-void XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
+bool XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
     const char* name,
     unsigned int& field ) const
 {
     tinyxml2::XMLElement* deviceEntry = deviceRoot->FirstChildElement( name );
-    if(deviceEntry)
-    {
-        std::string text = deviceEntry->GetText();
-        if(text.find("0x") != std::string::npos)
-        {
-            field = std::stoul( deviceEntry->GetText(), 0, 16 );
-        }
-        else
-        {
-            field = std::stoul( deviceEntry->GetText() );
-        }
-    }
-    else
-    {
-        field = 0;
-    }
+    field = deviceEntry ? svd::parseUnsigned( textOf( deviceEntry ) ) : 0;
+    return deviceEntry != nullptr;
+}
+bool XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
+    const char* name,
+    std::uint64_t& field ) const
+{
+    tinyxml2::XMLElement* deviceEntry = deviceRoot->FirstChildElement( name );
+    field = deviceEntry ? svd::parseUnsigned64( textOf( deviceEntry ) ) : 0;
+    return deviceEntry != nullptr;
 }
-void XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
+bool XmlParser::setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot,
     const char* name,
     EAccess& field ) const
 {
     tinyxml2::XMLElement* deviceEntry = deviceRoot->FirstChildElement( name );
     if( deviceEntry == nullptr ) {
         field = EAccess::Read_Write;
-        return;
-    }
-    const std::string text = deviceEntry->GetText();
-    if( text == "read-only" ) {
-        field = EAccess::Read_Only;
-    }
-    else if( text == "write-only" ) {
-        field = EAccess::Write_Only;
-    }
-    else if( text == "read-write" ) {
-        field = EAccess::Read_Write;
-    }
-    else {
-        std::cout << "Wrong field for access: " << text << std::endl;
+        return false;
     }
+    svd::parseAccess( textOf( deviceEntry ), field );
+    return true;
 }
-Peripheral XmlParser::parsePeripheral( tinyxml2::XMLElement* peripheralRoot ) const
+Peripheral XmlParser::parsePeripheral( tinyxml2::XMLElement* peripheralRoot,
+    svd::PeripheralDerivations& derivations ) const
 {
-    //Check if peripheral is derived from previous one
-    const char* attribute = peripheralRoot->Attribute( "derivedFrom" );
-    const bool isDerived = attribute != nullptr;
-    const std::string derivedFrom = isDerived ? attribute : "";
-
     Peripheral peripheral;
-    if( isDerived == true ) {
-        //Find the base peripheral and copy it to the new one
-        auto crit = [&]( auto& periph ) { return periph.name == derivedFrom; };
-        auto resultIt = std::find_if( peripherals.begin(), peripherals.end(), crit );
-        if( resultIt <= peripherals.end() ) {
-            peripheral = Peripheral( *resultIt );
-        }
-        else {
-            std::cout << "Couldn't find peripheral " << derivedFrom << std::endl;
-        }
+    const char* derivedFrom = peripheralRoot->Attribute( "derivedFrom" );
+    peripheral.derivedFrom = derivedFrom ? derivedFrom : "";
+
+    //Remember what a derived peripheral specifies itself, the rest comes from its base
+    unsigned int& specified = derivations.specified;
+    auto mark = [&]( bool found, unsigned int element ) { specified |= found ? element : 0; };
+    mark( setDeviceInfoAttrib( peripheralRoot, "name", peripheral.name ), svd::PeripheralName );
+    mark( setDeviceInfoAttrib( peripheralRoot, "baseAddress", peripheral.baseAddress ), svd::PeripheralBaseAddress );
+    mark( setDeviceInfoAttrib( peripheralRoot, "description", peripheral.description ), svd::PeripheralDescription );
+    mark( setDeviceInfoAttrib( peripheralRoot, "groupName", peripheral.groupName ), svd::PeripheralGroupName );
+    tinyxml2::XMLElement* addressBlockRoot = peripheralRoot->FirstChildElement( "addressBlock" );
+    mark( addressBlockRoot != nullptr, svd::PeripheralAddressBlock );
+    if( addressBlockRoot != nullptr || derivedFrom == nullptr ) {
+        peripheral.addressBlock = parseAddressBlock( addressBlockRoot );
     }
-    setDeviceInfoAttrib( peripheralRoot, "name", peripheral.name );
-    setDeviceInfoAttrib( peripheralRoot, "baseAddress", peripheral.baseAddress );
-    if( isDerived == false ) {
-        setDeviceInfoAttrib( peripheralRoot, "description", peripheral.description );
-        setDeviceInfoAttrib( peripheralRoot, "groupName", peripheral.groupName );
-        peripheral.addressBlock = parseAddressBlock( peripheralRoot->FirstChildElement( "addressBlock" ) );
-
-        //Iterate over all registers and append them to peripheral
-        tinyxml2::XMLElement* registersRoot = peripheralRoot->FirstChildElement( "registers" );
-        if( registersRoot != nullptr ) {
-            for( tinyxml2::XMLNode* registerRoot = registersRoot->FirstChild(); registerRoot;
-                 registerRoot = registerRoot->NextSibling() ) {
-                //Parse only "register" node
-                if( std::string( registerRoot->Value() ) != "register" ) {
-                    std::cout << "Register node has value " << registerRoot->Value();
-                    continue;
-                }
-                peripheral.registers.push_back( parseRegister( registerRoot->ToElement() ) );
-            }
-        }
+
+    //Iterate over all registers and append them to peripheral
+    tinyxml2::XMLElement* registersRoot = peripheralRoot->FirstChildElement( "registers" );
+    mark( registersRoot != nullptr, svd::PeripheralRegisters );
+    if( registersRoot != nullptr ) {
+        peripheral.registers = std::make_shared< RegisterList >();
+        parseRegisters( registersRoot, derivations, *peripheral.registers );
+        svd::applyDefaults( *peripheral.registers, 0, parseRegisterDefaults( peripheralRoot ) );
     }
     // peripheral.display();
     return peripheral;
 }
 
+Peripheral XmlParser::parsePeripheralHeader( tinyxml2::XMLElement* peripheralRoot ) const
+{
+    Peripheral peripheral;
+    const char* derivedFrom = peripheralRoot->Attribute( "derivedFrom" );
+    peripheral.derivedFrom = derivedFrom ? derivedFrom : "";
+    setDeviceInfoAttrib( peripheralRoot, "name", peripheral.name );
+    setDeviceInfoAttrib( peripheralRoot, "groupName", peripheral.groupName );
+    return peripheral;
+}
+
+svd::RegisterDefaults XmlParser::parseRegisterDefaults( tinyxml2::XMLElement* root ) const
+{
+    svd::RegisterDefaults defaults;
+    auto mark = [&]( bool found, unsigned int element ) { defaults.specified |= found ? element : 0; };
+    mark( setDeviceInfoAttrib( root, "size", defaults.size ), svd::RegisterSize );
+    mark( setDeviceInfoAttrib( root, "access", defaults.access ), svd::RegisterAccess );
+    mark( setDeviceInfoAttrib( root, "resetValue", defaults.resetValue ), svd::RegisterResetValue );
+    return defaults;
+}
+
 AddressBlock XmlParser::parseAddressBlock( tinyxml2::XMLElement* addressBlockRoot ) const
 {
     AddressBlock addressBlock;
@@ -147,43 +225,116 @@ AddressBlock XmlParser::parseAddressBlock( tinyxml2::XMLElement* addressBlockRoo
         setDeviceInfoAttrib( addressBlockRoot, "size", addressBlock.size );
     }
     else {
-        std::cout << "addressBlockRoot is nullptr" << std::endl;
+        logging::getLogger( "parser" ).warn( "addressBlockRoot is nullptr" );
     }
     return addressBlock;
 }
 
-Register XmlParser::parseRegister( tinyxml2::XMLElement* registerRoot ) const
+void XmlParser::parseRegisters( tinyxml2::XMLElement* registersRoot,
+    svd::PeripheralDerivations& derivations,
+    RegisterList& registers ) const
+{
+    //Iterate over all registers and clusters and append them to registers
+    for( tinyxml2::XMLElement* registerRoot = registersRoot->FirstChildElement(); registerRoot;
+         registerRoot = registerRoot->NextSiblingElement() ) {
+        const std::string_view name = registerRoot->Name();
+        if( name == "cluster" ) {
+            parseCluster( registerRoot, derivations, registers );
+            continue;
+        }
+        //Parse only "register" node, a cluster's own elements are expected
+        if( name != "register" ) {
+            if( std::string_view( registersRoot->Name() ) == "registers" ) {
+                logging::getLogger( "parser" ).warn( "Register node has value {}", registerRoot->Name() );
+            }
+            continue;
+        }
+        registers.push_back( parseRegister( registerRoot, derivations, registers.size() ) );
+    }
+}
+
+void XmlParser::parseCluster( tinyxml2::XMLElement* clusterRoot,
+    svd::PeripheralDerivations& derivations,
+    RegisterList& registers ) const
+{
+    svd::Cluster cluster;
+    if( clusterRoot->Attribute( "derivedFrom" ) != nullptr ) {
+        logging::getLogger( "parser" ).warn(
+            "Cluster derivedFrom is not supported: {}", clusterRoot->Attribute( "derivedFrom" ) );
+    }
+    setDeviceInfoAttrib( clusterRoot, "name", cluster.name );
+    setDeviceInfoAttrib( clusterRoot, "addressOffset", cluster.addressOffset );
+    cluster.defaults = parseRegisterDefaults( clusterRoot );
+    setDeviceInfoAttrib( clusterRoot, "dim", cluster.dim );
+    setDeviceInfoAttrib( clusterRoot, "dimIncrement", cluster.dimIncrement );
+    if( !setDeviceInfoAttrib( clusterRoot, "dimIndex", cluster.dimIndex ) ) {
+        cluster.dimIndex.clear();
+    }
+    const std::size_t first = registers.size();
+    parseRegisters( clusterRoot, derivations, registers );
+    svd::flattenCluster( cluster, registers, first, derivations );
+}
+
+Register XmlParser::parseRegister( tinyxml2::XMLElement* registerRoot,
+    svd::PeripheralDerivations& derivations,
+    std::size_t registerIndex ) const
 {
     Register registe;
-    setDeviceInfoAttrib( registerRoot, "name", registe.name );
-    setDeviceInfoAttrib( registerRoot, "description", registe.description );
-    setDeviceInfoAttrib( registerRoot, "addressOffset", registe.addressOffset );
-    setDeviceInfoAttrib( registerRoot, "size", registe.size );
-    setDeviceInfoAttrib( registerRoot, "access", registe.registerAccess );
-    setDeviceInfoAttrib( registerRoot, "resetValue", registe.resetValue );
+    const char* derivedFrom = registerRoot->Attribute( "derivedFrom" );
+    registe.derivedFrom = derivedFrom ? derivedFrom : "";
+
+    unsigned int specified = 0;
+    auto mark = [&]( bool found, unsigned int element ) { specified |= found ? element : 0; };
+    mark( setDeviceInfoAttrib( registerRoot, "name", registe.name ), svd::RegisterName );
+    mark( setDeviceInfoAttrib( registerRoot, "description", registe.description ), svd::RegisterDescription );
+    mark( setDeviceInfoAttrib( registerRoot, "addressOffset", registe.addressOffset ), svd::RegisterAddressOffset );
+    mark( setDeviceInfoAttrib( registerRoot, "size", registe.size ), svd::RegisterSize );
+    mark( setDeviceInfoAttrib( registerRoot, "access", registe.registerAccess ), svd::RegisterAccess );
+    mark( setDeviceInfoAttrib( registerRoot, "resetValue", registe.resetValue ), svd::RegisterResetValue );
+    mark( setDeviceInfoAttrib( registerRoot, "dim", registe.dim ), svd::RegisterDim );
+    mark( setDeviceInfoAttrib( registerRoot, "dimIncrement", registe.dimIncrement ), svd::RegisterDimIncrement );
+    if( setDeviceInfoAttrib( registerRoot, "dimIndex", registe.dimIndex ) ) {
+        mark( true, svd::RegisterDimIndex );
+    }
+    else {
+        registe.dimIndex.clear();
+    }
 
     //Iterate over all fields and append them to registe
     tinyxml2::XMLElement* fieldsRoot = registerRoot->FirstChildElement( "fields" );
+    mark( fieldsRoot != nullptr, svd::RegisterFields );
     if( fieldsRoot != nullptr ) {
-        for( tinyxml2::XMLNode* fieldRoot = fieldsRoot->FirstChild(); fieldRoot;
-             fieldRoot = fieldRoot->NextSibling() ) {
+        for( tinyxml2::XMLElement* fieldRoot = fieldsRoot->FirstChildElement(); fieldRoot;
+             fieldRoot = fieldRoot->NextSiblingElement() ) {
             //Parse only "field" node
-            if( std::string( fieldRoot->Value() ) != "field" ) {
-                std::cout << "Field node has value " << fieldRoot->Value();
+            if( std::string_view( fieldRoot->Name() ) != "field" ) {
+                logging::getLogger( "parser" ).warn( "Field node has value {}", fieldRoot->Name() );
                 continue;
             }
-            registe.fields.push_back( parseField( fieldRoot->ToElement() ) );
+            unsigned int fieldSpecified = 0;
+            registe.fields.push_back( parseField( fieldRoot, fieldSpecified ) );
+            if( !registe.fields.back().derivedFrom.empty() ) {
+                derivations.fields.push_back( { registerIndex, registe.fields.size() - 1, fieldSpecified } );
+            }
         }
     }
+    if( derivedFrom != nullptr ) {
+        derivations.registers.push_back( { registerIndex, specified } );
+    }
+    registe.specified = specified;
     return registe;
 }
-Field XmlParser::parseField( tinyxml2::XMLElement* fieldRoot ) const
+Field XmlParser::parseField( tinyxml2::XMLElement* fieldRoot, unsigned int& specified ) const
 {
     Field field;
-    setDeviceInfoAttrib( fieldRoot, "name", field.name );
-    setDeviceInfoAttrib( fieldRoot, "description", field.description );
-    setDeviceInfoAttrib( fieldRoot, "bitOffset", field.bitOffset );
-    setDeviceInfoAttrib( fieldRoot, "bitWidth", field.bitWidth );
-    setDeviceInfoAttrib( fieldRoot, "access", field.fieldAccess );
+    const char* derivedFrom = fieldRoot->Attribute( "derivedFrom" );
+    field.derivedFrom = derivedFrom ? derivedFrom : "";
+
+    auto mark = [&]( bool found, unsigned int element ) { specified |= found ? element : 0; };
+    mark( setDeviceInfoAttrib( fieldRoot, "name", field.name ), svd::FieldName );
+    mark( setDeviceInfoAttrib( fieldRoot, "description", field.description ), svd::FieldDescription );
+    mark( setDeviceInfoAttrib( fieldRoot, "bitOffset", field.bitOffset ), svd::FieldBitOffset );
+    mark( setDeviceInfoAttrib( fieldRoot, "bitWidth", field.bitWidth ), svd::FieldBitWidth );
+    mark( setDeviceInfoAttrib( fieldRoot, "access", field.fieldAccess ), svd::FieldAccess );
     return field;
 }
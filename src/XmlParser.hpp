@@ -1,8 +1,11 @@
 #ifndef XML_PARSER
 #define XML_PARSER
 
+#include "Derivation.hpp"
 #include "DeviceInfo.hpp"
+#include "IParser.hpp"
 #include "Peripheral.hpp"
+#include "Selection.hpp"
 
 #include <memory>
 #include <optional>
@@ -11,33 +14,59 @@
 
 #include <tinyxml2.h>
 
-struct XmlParser
+struct XmlParser : public IParser
 {
-    XmlParser( const std::string& inputFile );
-    std::optional< std::string > isError() const;
-    void parseXml();
-    inline const DeviceInfo& getDeviceInfo() const
+    // With jobs > 1 the <peripheral> subtrees are parsed on a WorkerPool.
+    // Peripherals the filter doesn't need are never parsed beyond their name.
+    XmlParser( const std::string& inputFile, unsigned int jobs_ = 1, svd::PeripheralFilter filter_ = {} );
+    std::optional< std::string > isError() const final;
+    void parseXml() final;
+    inline const DeviceInfo& getDeviceInfo() const final
     {
         return deviceInfo;
     }
-    inline const std::vector< Peripheral >& getPeripherals() const
+    inline const std::vector< Peripheral >& getPeripherals() const final
     {
         return peripherals;
     }
+    inline const ParsePhases& getPhases() const final
+    {
+        return phases;
+    }
 
 private:
     // tinyxml2::XMLElement* getDevice
-    void setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, std::string& field ) const;
-    void setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, unsigned int& field ) const;
-    void setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, EAccess& field ) const;
+    // Each returns whether the element was present
+    bool setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, std::string& field ) const;
+    bool setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, unsigned int& field ) const;
+    bool setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, std::uint64_t& field ) const;
+    bool setDeviceInfoAttrib( tinyxml2::XMLElement* deviceRoot, const char* name, EAccess& field ) const;
 
-    Peripheral parsePeripheral( tinyxml2::XMLElement* peripheralRoot ) const;
+    Peripheral parsePeripheral( tinyxml2::XMLElement* peripheralRoot, svd::PeripheralDerivations& derivations ) const;
+    // Only what selecting peripherals looks at: name, groupName and derivedFrom
+    Peripheral parsePeripheralHeader( tinyxml2::XMLElement* peripheralRoot ) const;
+    // size, access and resetValue given on the device, peripheral or cluster level
+    svd::RegisterDefaults parseRegisterDefaults( tinyxml2::XMLElement* root ) const;
     AddressBlock parseAddressBlock( tinyxml2::XMLElement* addressBlockRoot ) const;
-    Register parseRegister( tinyxml2::XMLElement* registerRoot ) const;
-    Field parseField( tinyxml2::XMLElement* fieldRoot ) const;
+    // Registers and flattened clusters below registersRoot
+    void parseRegisters( tinyxml2::XMLElement* registersRoot,
+        svd::PeripheralDerivations& derivations,
+        RegisterList& registers ) const;
+    void parseCluster( tinyxml2::XMLElement* clusterRoot,
+        svd::PeripheralDerivations& derivations,
+        RegisterList& registers ) const;
+    Register parseRegister( tinyxml2::XMLElement* registerRoot,
+        svd::PeripheralDerivations& derivations,
+        std::size_t registerIndex ) const;
+    Field parseField( tinyxml2::XMLElement* fieldRoot, unsigned int& specified ) const;
 
 private:
+    ParsePhases phases;
     tinyxml2::XMLDocument xmlDocument;
+    // Reading a compressed or archived input failed, see input::read
+    std::string loadError;
+    const unsigned int jobs;
+    const svd::PeripheralFilter filter;
     static const inline std::string noValue = "Not found";
     DeviceInfo deviceInfo;
     std::vector< Peripheral > peripherals;
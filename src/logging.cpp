@@ -1,5 +1,7 @@
 #include "logging.h"
 
+#include <mutex>
+
 static auto extractFileName( const std::string& filePath ) -> std::string
 {
     size_t pos{ filePath.find_last_of( "/\\" ) };
@@ -15,6 +17,9 @@ namespace logging {
 
 auto getLogger( const std::string& name ) -> spdlog::logger&
 {
+    //Parser threads may ask for the same new logger at once
+    static std::mutex creation;
+    std::lock_guard< std::mutex > lock( creation );
     auto logger{ spdlog::get( name ) };
 
     if( !logger ) {
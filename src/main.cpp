@@ -1,10 +1,11 @@
-#include "FileBuilder.hpp"
-#include "XmlParser.hpp"
+#include "BatchRunner.hpp"
+#include "Generator.hpp"
+#include "Stats.hpp"
+#include "Watcher.hpp"
 
 #include <cxxopts.hpp>
 
 #include <iostream>
-#include <fstream>
 /* #include <OutputFile.hpp> */
 
 int main( int argc, char** argv )
@@ -13,7 +14,35 @@ int main( int argc, char** argv )
     cxxopts::Options options( "svd2cpp", "Parser from svd files to C++ header" );
     options.add_options()(
         "i, input", "File with .svd extention to be parsed", cxxopts::value< std::string >() )(
-        "o, output", "Output file", cxxopts::value< std::string >() )( "h, help", "Print help" );
+        "o, output", "Output file", cxxopts::value< std::string >() )(
+        "p, parser", "SVD parser backend: dom (tinyxml2) or stream (single pass, no DOM)",
+        cxxopts::value< std::string >()->default_value( "dom" ) )(
+        "b, batch", "Batch inputs: directories, glob patterns or @manifest files",
+        cxxopts::value< std::vector< std::string > >() )(
+        "d, output-dir", "Output directory for batch mode", cxxopts::value< std::string >() )(
+        "j, jobs", "Number of worker threads for batch devices or header emission (0 = one per core)",
+        cxxopts::value< unsigned int >()->default_value( "0" ) )(
+        "only", "Generate only peripherals whose name or groupName matches (name or glob, repeatable)",
+        cxxopts::value< std::vector< std::string > >() )(
+        "exclude", "Skip peripherals whose name or groupName matches (name or glob, repeatable)",
+        cxxopts::value< std::vector< std::string > >() )(
+        "dedup", "Share one type between structurally identical peripherals and registers" )(
+        "overlay", "Access registers through a volatile struct per peripheral, sharing one base address" )(
+        "lean", "Emit registers as types only, without address() helpers or data members, for cheaper compiles" )(
+        "atomic", "Single-store set/reset/toggle policy: [PERIPHERAL=]none (default), bitband or alias:SET:CLEAR:TOGGLE offsets (repeatable)",
+        cxxopts::value< std::vector< std::string > >() )(
+        "no-runtime", "Don't write RegBase.h, the runtime the headers include, next to them" )(
+        "s, split", "Write one header per peripheral or group into the --output directory: peripheral or group",
+        cxxopts::value< std::string >() )(
+        "cache-dir", "Reuse outputs of earlier runs with the same input, version and options",
+        cxxopts::value< std::string >() )(
+        "dump-model", "Save the parsed device model to a binary file", cxxopts::value< std::string >() )(
+        "load-model", "Generate from a device model saved with --dump-model instead of an .svd file",
+        cxxopts::value< std::string >() )(
+        "stats", "Log time and heap allocations of every phase, peak RSS and per-peripheral output sizes" )(
+        "stats-json", "Write the --stats report as JSON to this file", cxxopts::value< std::string >() )(
+        "watch", "Keep running and regenerate whenever the input changes, emitting only changed peripherals (Linux)" )(
+        "h, help", "Print help" );
 
     std::string inputFile, outputFile;
     auto result = options.parse( argc, argv );
@@ -22,39 +51,63 @@ int main( int argc, char** argv )
             std::cout << options.help() << std::endl;
             return 0;
         }
-        if( result.count( "input" ) != 1 ) {
+        countAllocations( result.count( "stats" ) || result.count( "stats-json" ) );
+        if( result.count( "batch" ) ) {
+            if( result.count( "input" ) || result.count( "output" ) ) {
+                std::cout << "Batch mode can't be combined with --input/--output!" << std::endl;
+                return 1;
+            }
+            if( result.count( "dump-model" ) || result.count( "load-model" ) ) {
+                std::cout << "Batch mode can't be combined with --dump-model/--load-model!" << std::endl;
+                return 1;
+            }
+            if( result.count( "stats-json" ) || result.count( "watch" ) ) {
+                std::cout << "Batch mode can't be combined with --stats-json/--watch!" << std::endl;
+                return 1;
+            }
+            if( result.count( "output-dir" ) != 1 ) {
+                std::cout << "Missing output directory!" << std::endl;
+                return 1;
+            }
+            BatchRunner batch( result, result["batch"].as< std::vector< std::string > >(),
+                result["output-dir"].as< std::string >() );
+            batch.run( result["jobs"].as< unsigned int >() );
+            batch.printSummary( std::cout );
+            return batch.allSucceeded() ? 0 : 4;
+        }
+        if( result.count( "input" ) + result.count( "load-model" ) != 1 ) {
             std::cout << "Missing input file!" << std::endl;
             return 1;
         }
-        if( result.count( "output" ) != 1 ) {
+        if( result.count( "output" ) != 1 && !result.count( "dump-model" ) ) {
             std::cout << "Missing output file!" << std::endl;
             return 1;
         }
-        inputFile = result["input"].as< std::string >();
-        outputFile = result["output"].as< std::string >();
+        inputFile = result.count( "input" ) ? result["input"].as< std::string >()
+                                            : result["load-model"].as< std::string >();
+        outputFile = result.count( "output" ) ? result["output"].as< std::string >() : "";
         // std::cout << "Input: " << inputFile << "\tOutput: " << outputFile << std::endl;
     }
     catch( const std::exception& ex ) {
         std::cout << ex.what() << std::endl;
         return 2;
     }
-    //Try to parse the file
-    XmlParser xmlParser( inputFile );
-    if( auto err = xmlParser.isError() ) {
-        std::cout << "There was an error while reading " << inputFile << ":" << std::endl
-                  << *err << std::endl;
-        return 3;
+    if( result.count( "watch" ) ) {
+        if( outputFile.empty() ) {
+            std::cout << "Missing output file!" << std::endl;
+            return 1;
+        }
+        return Watcher( result, result["jobs"].as< unsigned int >() ).run( inputFile, outputFile );
+    }
+    //Parse the file and write the header
+    const GenerationResult generated = Generator( result, result["jobs"].as< unsigned int >() ).run( inputFile, outputFile );
+    if( !generated.ok() ) {
+        std::cout << generated.message << std::endl;
+        return generated.status == EGenerationStatus::ReadError ? 3 : 4;
+    }
+    if( generated.dedup ) {
+        std::cout << generated.dedup->describe() << std::endl;
     }
-    xmlParser.parseXml();
-    FileBuilder classBuilder(result, xmlParser.getDeviceInfo(), xmlParser.getPeripherals() );
-    classBuilder.setupBuilders();
-    classBuilder.build();
-
-    /* OutputFile oFile(outputFile); */
-    /* std::cout << (oFile.save(classBuilder.getStream()) ? "Successfuly created " : "Failed to create ") << outputFile << std::endl; */
-    std::ofstream oFile(outputFile);
-    oFile << classBuilder.getStream().str() << std::endl;
-    oFile.close();
 
     return 0;
 }
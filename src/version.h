@@ -1,6 +1,8 @@
 #pragma once
 
-#include <format>
+#include <fmt/core.h>
+
+#include <string>
 
 #include "types.h"
 
@@ -11,7 +13,7 @@
 
 namespace version {
 
-static constexpr inline Version PROJECT_VERSION{
+static constexpr inline types::Version PROJECT_VERSION{
     PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, PROJECT_VERSION_PATCH };
 
 #ifdef NDEBUG
@@ -23,12 +25,12 @@ constexpr bool is_debug = true;
 static constexpr inline const char* BUILD_VERSION = "<COMMIT_SHA>";
 static constexpr inline const char* BUILD_TYPE = is_debug ? "DEBUG" : "RELEASE";
 
-auto getVersionInfo() -> std::string
+inline auto getVersionInfo() -> std::string
 {
-    return std::format( "{}.{}.{}", PROJECT_VERSION.major, PROJECT_VERSION.minor, PROJECT_VERSION.patch );
+    return fmt::format( "{}.{}.{}", PROJECT_VERSION.major, PROJECT_VERSION.minor, PROJECT_VERSION.patch );
 }
 
-auto getBuildInfo() -> std::string
+inline auto getBuildInfo() -> std::string
 {
     std::string build_type{ BUILD_TYPE };
     std::string build_version{ BUILD_VERSION };
@@ -37,7 +39,7 @@ auto getBuildInfo() -> std::string
         return build_type;
     }
 
-    return std::format( "{}-{}", build_version, build_type );
+    return fmt::format( "{}-{}", build_version, build_type );
 }
 
 } // namespace version
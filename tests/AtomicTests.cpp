@@ -0,0 +1,74 @@
+#include "Deduplication.hpp"
+#include "Fixtures.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace {
+
+// Text of the class or alias of the peripheral, up to the next template
+std::string declarationOf( const std::string& header, const std::string& name )
+{
+    auto start = header.find( "class " + name + " {" );
+    if( start == std::string::npos ) {
+        start = header.find( "using " + name + " =" );
+    }
+    if( start == std::string::npos ) {
+        return {};
+    }
+    return header.substr( start, header.find( "template<typename _T", start ) - start );
+}
+
+} // namespace
+
+TEST_CASE( "Aliases keep the atomic policy of their own address", "[atomic]" )
+{
+    const std::string input = fixtures::data( "atomic.svd" ).string();
+    const std::string header = fixtures::emitHeader( input, { "--atomic", "bitband" } );
+    CHECK( declarationOf( header, "Gpioa" ).find( "using Atomic = BitBand;" ) != std::string::npos );
+    CHECK( declarationOf( header, "Gpiob" ) == "using Gpiob = Gpioa<_T, BaseAddr>;\n\n" );
+    //GPIOH is outside the bit-band region, the class of GPIOA would bit-band it
+    const std::string gpioh = declarationOf( header, "Gpioh" );
+    CHECK( gpioh.find( "class Gpioh {" ) == 0 );
+    CHECK( gpioh.find( "Atomic" ) == std::string::npos );
+
+    const std::string aliased
+        = fixtures::emitHeader( input, { "--atomic", "bitband", "--atomic", "GPIOB=alias:0x1000:0x2000:0" } );
+    CHECK( declarationOf( aliased, "Gpiob" ).find( "using Atomic = AliasOffsets<0x1000, 0x2000, 0x0>;" )
+        != std::string::npos );
+    CHECK( declarationOf( aliased, "Gpioa" ).find( "using Atomic = BitBand;" ) != std::string::npos );
+
+    //Without policies every derived peripheral stays an alias
+    const std::string none = fixtures::emitHeader( input, { "--atomic", "none" } );
+    CHECK( declarationOf( none, "Gpioh" ) == "using Gpioh = Gpioa<_T, BaseAddr>;\n\n" );
+}
+
+TEST_CASE( "A Cortex-M4 <cpu> alone doesn't select bit-banding", "[atomic]" )
+{
+    const std::string input = fixtures::data( "atomic.svd" ).string();
+    REQUIRE( fixtures::parseModel( input ).getDeviceInfo().cpuName == "CM4" );
+    const std::string header = fixtures::emitHeader( input );
+    CHECK( header.find( "Atomic" ) == std::string::npos );
+    CHECK( header == fixtures::emitHeader( input, { "--atomic", "none" } ) );
+}
+
+TEST_CASE( "Deduplication keeps peripherals with different policies apart", "[atomic][dedup]" )
+{
+    const std::string input = fixtures::data( "atomic.svd" ).string();
+    //PORTX has the registers of GPIOA, but is outside the bit-band region
+    DeviceModel model = fixtures::parseModel( input );
+    CHECK( Deduplicator::run( model, AtomicPolicies( { "bitband" } ) ).peripheralTypes == 0 );
+    const std::string header = fixtures::emitHeader( input, { "--dedup", "--atomic", "bitband" } );
+    CHECK( declarationOf( header, "Portx" ).find( "class Portx {" ) == 0 );
+    CHECK( declarationOf( header, "Portx" ).find( "Atomic" ) == std::string::npos );
+
+    DeviceModel same = fixtures::parseModel( input );
+    CHECK( Deduplicator::run( same, AtomicPolicies( { "none" } ) ).peripheralTypes == 1 );
+    const std::string none = fixtures::emitHeader( input, { "--dedup", "--atomic", "none" } );
+    CHECK( declarationOf( none, "Portx" ).find( "using Portx = Gpioa<_T, BaseAddr>;" ) == 0 );
+
+    //Equal policies from a rule are merged as before
+    DeviceModel aliased = fixtures::parseModel( input );
+    CHECK( Deduplicator::run( aliased, AtomicPolicies( { "alias:0x1000:0x2000:0" } ) ).peripheralTypes == 1 );
+}
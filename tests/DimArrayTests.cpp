@@ -0,0 +1,167 @@
+#include "Fixtures.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace {
+
+const RegisterRecord* registerNamed( const DeviceModel& model, std::string_view peripheral, std::string_view name )
+{
+    for( auto& record : model.getPeripherals() ) {
+        if( model.str( record.name ) != peripheral ) {
+            continue;
+        }
+        for( auto& registe : model.registersOf( model.peripheralAt( record.layout ) ) ) {
+            if( model.str( registe.name ) == name ) {
+                return &registe;
+            }
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST_CASE( "derivedFrom inside a cluster names a register of the cluster", "[dim][derived]" )
+{
+    const std::string input = fixtures::writeTemp( "clusterderived.svd", R"(<?xml version="1.0" encoding="utf-8"?>
+<device schemaVersion="1.1"><name>CLUSTERS</name><version>1.0</version><size>32</size><resetValue>0</resetValue>
+<peripherals><peripheral><name>CAN</name><baseAddress>0x40006400</baseAddress>
+<addressBlock><offset>0</offset><size>0x400</size></addressBlock><registers>
+<register><name>ID</name><addressOffset>0x0</addressOffset></register>
+<cluster><name>TX</name><addressOffset>0x100</addressOffset>
+  <register><name>ID</name><addressOffset>0x0</addressOffset><size>16</size>
+    <fields><field><name>STD</name><bitOffset>0</bitOffset><bitWidth>11</bitWidth></field></fields></register>
+  <register derivedFrom="ID"><name>MASK</name><addressOffset>0x4</addressOffset></register>
+  <register><name>CTRL</name><addressOffset>0x8</addressOffset>
+    <fields><field derivedFrom="ID.STD"><name>EXT</name></field></fields></register>
+</cluster>
+<cluster><dim>2</dim><dimIncrement>0x10</dimIncrement><dimIndex>A,B</dimIndex><name>MB%s</name>
+  <addressOffset>0x200</addressOffset>
+  <register><dim>2</dim><dimIncrement>4</dimIncrement><name>DATA%s</name><addressOffset>0x8</addressOffset>
+    <size>8</size><fields><field><name>BYTE</name><bitOffset>0</bitOffset><bitWidth>8</bitWidth></field></fields>
+  </register>
+  <register derivedFrom="DATA%s"><name>CODE%s</name><addressOffset>0x0</addressOffset></register>
+</cluster>
+</registers></peripheral></peripherals></device>
+)" ).string();
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        const DeviceModel model = fixtures::parseModel( input, { "--parser", parser } );
+        const RegisterRecord* mask = registerNamed( model, "CAN", "TX_MASK" );
+        REQUIRE( mask != nullptr );
+        //The cluster's ID, not the peripheral's 32-bit one without fields
+        CHECK( mask->size == 16 );
+        CHECK( mask->addressOffset == 0x104 );
+        REQUIRE( mask->fieldCount == 1 );
+        CHECK( model.str( model.fieldsOf( *mask )[0].name ) == "STD" );
+        const RegisterRecord* ctrl = registerNamed( model, "CAN", "TX_CTRL" );
+        REQUIRE( ctrl != nullptr );
+        REQUIRE( ctrl->fieldCount == 1 );
+        CHECK( model.str( model.fieldsOf( *ctrl )[0].name ) == "EXT" );
+        CHECK( model.fieldsOf( *ctrl )[0].bitWidth == 11 );
+        //Every element of an unrolled cluster array derives from its own copy
+        for( auto code : { "MBA_CODE%s", "MBB_CODE%s" } ) {
+            INFO( code );
+            const RegisterRecord* registe = registerNamed( model, "CAN", code );
+            REQUIRE( registe != nullptr );
+            CHECK( registe->size == 8 );
+            CHECK( registe->dim == 2 );
+            REQUIRE( registe->fieldCount == 1 );
+            CHECK( model.str( model.fieldsOf( *registe )[0].name ) == "BYTE" );
+        }
+        CHECK( registerNamed( model, "CAN", "MBB_CODE%s" )->addressOffset == 0x210 );
+    }
+
+    const DeviceModel arrays = fixtures::parseModel( fixtures::data( "arrays.svd" ).string() );
+    const RegisterRecord* id = registerNamed( arrays, "DMA1", "MBA_ID" );
+    REQUIRE( id != nullptr );
+    CHECK( id->dim == 2 );
+    CHECK( id->dimIncrement == 4 );
+}
+
+TEST_CASE( "dim registers and clusters stay arrays in the model", "[dim]" )
+{
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        const DeviceModel model = fixtures::parseModel( fixtures::data( "arrays.svd" ).string(), { "--parser", parser } );
+        const RegisterRecord* ccr = registerNamed( model, "DMA1", "CCR%s" );
+        REQUIRE( ccr != nullptr );
+        CHECK( ccr->addressOffset == 0x8 );
+        CHECK( ccr->dim == 7 );
+        CHECK( ccr->dimIncrement == 0x14 );
+        CHECK( model.str( ccr->dimIndex ) == "1-7" );
+        //A cluster array of plain registers gives each of them the cluster's dim
+        const RegisterRecord* cr = registerNamed( model, "DMA1", "CH_CR" );
+        REQUIRE( cr != nullptr );
+        CHECK( cr->addressOffset == 0x100 );
+        CHECK( cr->dim == 4 );
+        CHECK( cr->dimIncrement == 0x10 );
+        const RegisterRecord* cnt = registerNamed( model, "DMA1", "CH_CNT" );
+        REQUIRE( cnt != nullptr );
+        CHECK( cnt->addressOffset == 0x104 );
+        //One holding register arrays is unrolled, named after dimIndex
+        CHECK( registerNamed( model, "DMA1", "MB%s_DATA%s" ) == nullptr );
+        const RegisterRecord* mbaData = registerNamed( model, "DMA1", "MBA_DATA%s" );
+        const RegisterRecord* mbbData = registerNamed( model, "DMA1", "MBB_DATA%s" );
+        REQUIRE( mbaData != nullptr );
+        REQUIRE( mbbData != nullptr );
+        CHECK( mbaData->addressOffset == 0x208 );
+        CHECK( mbbData->addressOffset == 0x228 );
+        CHECK( mbbData->dim == 2 );
+        CHECK( mbbData->dimIncrement == 4 );
+        const RegisterRecord* mode = registerNamed( model, "DMA1", "CTRL_MODE" );
+        REQUIRE( mode != nullptr );
+        CHECK( mode->addressOffset == 0x304 );
+        CHECK( mode->dim == 0 );
+        //The derived peripheral shares the arrays
+        CHECK( registerNamed( model, "DMA2", "CCR%s" ) == ccr );
+    }
+}
+
+TEST_CASE( "dim arrays are emitted as templates indexed by the element number", "[dim][emit]" )
+{
+    const std::string input = fixtures::data( "arrays.svd" ).string();
+    const std::string header = fixtures::emitHeader( input );
+    //Numbered dimIndex, N is the element's number
+    CHECK( header.find( "    template<unsigned int N>\n"
+                        "    class Ccr : public Register<_T, BaseAddr + 8 + ( N - 1 ) * 20> {\n"
+                        "      public:\n"
+                        "        static_assert( N >= 1 && N < 8, \"CCR index out of range\" );\n" )
+        != std::string::npos );
+    CHECK( header.find( "        using EN = Filed<Ccr, 0, 1>;\n" ) != std::string::npos );
+    //Elements of a cluster array are counted from 0
+    CHECK( header.find( "    class ChCr : public Register<_T, BaseAddr + 256 + N * 16> {\n"
+                        "      public:\n"
+                        "        static_assert( N < 4, \"CH_CR index out of range\" );\n" )
+        != std::string::npos );
+    CHECK( header.find( "    class ChCnt : public Register<_T, BaseAddr + 260 + N * 16> {" ) != std::string::npos );
+    CHECK( header.find( "    class MbaData : public Register<_T, BaseAddr + 520 + N * 4> {" ) != std::string::npos );
+    CHECK( header.find( "    class MbbData : public Register<_T, BaseAddr + 552 + N * 4> {" ) != std::string::npos );
+    CHECK( header.find( "class CCR" ) == std::string::npos );
+    CHECK( header.find( "    } CTRL_MODE;\n" ) != std::string::npos );
+    CHECK( header.find( "using Dma2 = Dma1<_T, BaseAddr>;" ) != std::string::npos );
+
+    //The runtime accessors are unchecked apart from a debug assert
+    CHECK( header.find( "    static inline volatile _T& ccr( unsigned int index ) { assert( index >= 1 && index < 8 ); "
+                        "return *reinterpret_cast<volatile _T*>( BaseAddr + 8 + ( index - 1 ) * 20 ); }\n" )
+        != std::string::npos );
+    CHECK( header.find( "    static inline volatile _T& chCr( unsigned int index ) { assert( index < 4 ); "
+                        "return *reinterpret_cast<volatile _T*>( BaseAddr + 256 + index * 16 ); }\n" )
+        != std::string::npos );
+
+    //With --overlay elements in the layout are reached through it
+    const std::string overlay = fixtures::emitHeader( input, { "--overlay" } );
+    CHECK( overlay.find( "        volatile _T MBA_DATA[2];\n" ) != std::string::npos );
+    CHECK( overlay.find( "        static inline volatile _T& ref() { return _layout()->MBA_DATA[N]; }\n" )
+        != std::string::npos );
+    CHECK( overlay.find( "    static inline volatile _T& mbaData( unsigned int index ) { assert( index < 2 ); "
+                         "return _layout()->MBA_DATA[index]; }\n" )
+        != std::string::npos );
+    //CCR's elements are 20 bytes apart, so it stays outside the layout
+    CHECK( overlay.find( "    static inline volatile _T& ccr( unsigned int index ) { assert( index >= 1 && index < 8 ); "
+                         "return *reinterpret_cast<volatile _T*>( BaseAddr + 8 + ( index - 1 ) * 20 ); }\n" )
+        != std::string::npos );
+}
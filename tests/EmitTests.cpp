@@ -0,0 +1,148 @@
+#include "Fixtures.hpp"
+#include "SplitFileBuilder.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Device of peripheralCount peripherals in four groups, every third one
+// derived from the one before it, so emission has enough work to spread
+std::string manyPeripherals( unsigned int peripheralCount )
+{
+    std::string peripherals;
+    for( unsigned int p = 0; p < peripheralCount; ++p ) {
+        const std::string derived = p % 3 == 2 ? fmt::format( " derivedFrom=\"P{}\"", p - 1 ) : "";
+        std::string registers;
+        for( unsigned int r = 0; r < 6 && derived.empty(); ++r ) {
+            registers += fmt::format( "<register><name>R{0}</name><addressOffset>{1}</addressOffset><size>{2}</size>"
+                                      "<resetValue>{3}</resetValue><fields><field><name>F{0}</name>"
+                                      "<bitOffset>{0}</bitOffset><bitWidth>2</bitWidth></field></fields></register>",
+                r, r * 8, r % 2 ? 16 : 32, r + p );
+        }
+        peripherals += fmt::format( "<peripheral{0}><name>P{1}</name><groupName>G{2}</groupName>"
+                                    "<baseAddress>0x{3:08X}</baseAddress><addressBlock><offset>0</offset><size>0x400</size>"
+                                    "</addressBlock>{4}</peripheral>\n",
+            derived, p, p % 4, 0x40000000 + p * 0x400,
+            registers.empty() ? "" : "<registers>" + registers + "</registers>" );
+    }
+    return fmt::format( R"(<?xml version="1.0" encoding="utf-8"?>
+<device schemaVersion="1.1"><name>MANY</name><version>1.0</version><size>32</size><resetValue>0</resetValue>
+<peripherals>
+{}</peripherals></device>
+)",
+        peripherals );
+}
+
+} // namespace
+
+TEST_CASE( "Emission with --jobs is byte identical to one job", "[emit][jobs]" )
+{
+    const std::string input = fixtures::writeTemp( "many.svd", manyPeripherals( 60 ) ).string();
+    for( auto args : { std::vector< const char* >{}, { "--dedup" }, { "--overlay" }, { "--lean" } } ) {
+        const std::string serial = fixtures::emitHeader( input, args );
+        REQUIRE( serial.find( "P59" ) != std::string::npos );
+        for( unsigned int jobs : { 2u, 4u, 7u } ) {
+            INFO( jobs << " jobs" );
+            CHECK( fixtures::emitHeader( input, args, jobs ) == serial );
+        }
+    }
+}
+
+TEST_CASE( "Split emission with --jobs is byte identical to one job", "[emit][jobs]" )
+{
+    const DeviceModel model = fixtures::parseModel( fixtures::writeTemp( "many.svd", manyPeripherals( 60 ) ).string() );
+    for( auto mode : { ESplitMode::Peripheral, ESplitMode::Group } ) {
+        SplitFileBuilder serial( model, mode );
+        serial.build();
+        const auto expected = serial.takeFiles();
+        SplitFileBuilder parallel( model, mode );
+        parallel.build( 4 );
+        const auto files = parallel.takeFiles();
+        REQUIRE( files.size() == expected.size() );
+        for( std::size_t i = 0; i < files.size(); ++i ) {
+            CHECK( files[i].name == expected[i].name );
+            CHECK( files[i].content == expected[i].content );
+        }
+    }
+}
+
+TEST_CASE( "Registers use the access type of their size", "[emit][width]" )
+{
+    const std::string header = fixtures::emitHeader( fixtures::data( "widths.svd" ).string() );
+    //Peripheral <size> 16 is the default of SPI1, the device's 32 of TIM1
+    CHECK( header.find( "class Cr1 : public Register<uint16_t, BaseAddr + 0>" ) != std::string::npos );
+    CHECK( header.find( "class Cr1 : public Register<uint32_t, BaseAddr + 0>" ) != std::string::npos );
+    CHECK( header.find( "class Dr8 : public Register<uint8_t, BaseAddr + 12>" ) != std::string::npos );
+    CHECK( header.find( "class Cnt : public Register<uint64_t, BaseAddr + 16>" ) != std::string::npos );
+    //derivedFrom copies the size, clusters pass theirs down
+    CHECK( header.find( "class Dr8b : public Register<uint8_t, BaseAddr + 13>" ) != std::string::npos );
+    CHECK( header.find( "class FifoLvl : public Register<uint8_t, BaseAddr + 32>" ) != std::string::npos );
+    CHECK( header.find( "class FifoCfg : public Register<uint32_t, BaseAddr + 36>" ) != std::string::npos );
+}
+
+TEST_CASE( "Reset values are folded into the register type", "[emit][width]" )
+{
+    const std::string input = fixtures::writeTemp( "reset.svd", R"(<?xml version="1.0" encoding="utf-8"?>
+<device schemaVersion="1.1"><name>RESET</name><version>1.0</version><size>32</size><resetValue>0x5</resetValue>
+<peripherals><peripheral><name>P</name><baseAddress>0x40000000</baseAddress>
+<addressBlock><offset>0</offset><size>0x400</size></addressBlock><registers>
+<register><name>DEF</name><addressOffset>0x0</addressOffset></register>
+<register><name>ZERO</name><addressOffset>0x4</addressOffset><resetValue>0</resetValue></register>
+<register><name>BYTE</name><addressOffset>0x8</addressOffset><size>8</size><resetValue>0x1A5</resetValue></register>
+<register><name>STAT</name><addressOffset>0xC</addressOffset><size>16</size><access>read-only</access><resetValue>0</resetValue></register>
+<register><name>CMD</name><addressOffset>0x10</addressOffset><access>write-only</access><resetValue>0x80</resetValue></register>
+<register><name>WIDE</name><addressOffset>0x18</addressOffset><size>64</size><resetValue>0xFEDCBA9876543210</resetValue></register>
+<register><name>HIGH</name><addressOffset>0x20</addressOffset><resetValue>0x100000005</resetValue></register>
+</registers></peripheral></peripherals></device>
+)" ).string();
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        const std::string header = fixtures::emitHeader( input, { "--parser", parser } );
+        CHECK( header.find( "class Def : public Register<uint32_t, BaseAddr + 0, 0x5>" ) != std::string::npos );
+        CHECK( header.find( "class Zero : public Register<uint32_t, BaseAddr + 4>" ) != std::string::npos );
+        //Bits above the register's size are dropped
+        CHECK( header.find( "class Byte : public Register<uint8_t, BaseAddr + 8, 0xa5>" ) != std::string::npos );
+        CHECK( header.find( "class Stat : public Register<uint16_t, BaseAddr + 12, 0x0, Access::ReadOnly>" )
+            != std::string::npos );
+        CHECK( header.find( "class Cmd : public Register<uint32_t, BaseAddr + 16, 0x80, Access::WriteOnly>" )
+            != std::string::npos );
+        CHECK( header.find( "class Wide : public Register<uint64_t, BaseAddr + 24, 0xfedcba9876543210>" )
+            != std::string::npos );
+        CHECK( header.find( "class High : public Register<uint32_t, BaseAddr + 32, 0x5>" ) != std::string::npos );
+    }
+}
+
+TEST_CASE( "64-bit reset values survive the model file", "[emit][width]" )
+{
+    const std::string input = fixtures::writeTemp( "reset64.svd", R"(<?xml version="1.0" encoding="utf-8"?>
+<device schemaVersion="1.1"><name>RESET64</name><version>1.0</version><size>64</size>
+<resetValue>0xFFFFFFFFFFFFFFFF</resetValue>
+<peripherals><peripheral><name>P</name><baseAddress>0x40000000</baseAddress>
+<addressBlock><offset>0</offset><size>0x400</size></addressBlock><registers>
+<register><name>ALL</name><addressOffset>0x0</addressOffset></register>
+<register><name>WIDE</name><addressOffset>0x8</addressOffset><resetValue>0x8000000000000001</resetValue></register>
+</registers></peripheral></peripherals></device>
+)" ).string();
+    auto checkResets = []( const DeviceModel& model ) {
+        CHECK( model.getDeviceInfo().resetValue == UINT64_MAX );
+        const auto registers = model.registersOf( *model.getPeripherals().begin() );
+        REQUIRE( registers.size() == 2 );
+        CHECK( registers[0].resetValue == UINT64_MAX );
+        CHECK( registers[1].resetValue == 0x8000000000000001 );
+    };
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        const DeviceModel model = fixtures::parseModel( input, { "--parser", parser } );
+        checkResets( model );
+        const auto path = fixtures::writeTemp( "reset64.model", "" ).string();
+        model.save( path );
+        checkResets( DeviceModel::load( path ) );
+    }
+    const std::string header = fixtures::emitHeader( input );
+    CHECK( header.find( "class All : public Register<uint64_t, BaseAddr + 0, 0xffffffffffffffff>" ) != std::string::npos );
+    CHECK( header.find( "class Wide : public Register<uint64_t, BaseAddr + 8, 0x8000000000000001>" ) != std::string::npos );
+}
@@ -0,0 +1,102 @@
+#include "Fixtures.hpp"
+#include "Deduplication.hpp"
+#include "FileBuilder.hpp"
+#include "Runtime.hpp"
+#include "StreamParser.hpp"
+#include "XmlParser.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace fixtures {
+
+std::filesystem::path data( const std::string& name )
+{
+    return std::filesystem::path( SVD2CPP_TEST_DATA ) / name;
+}
+
+std::filesystem::path writeTemp( const std::string& name, const std::string& text )
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / ( "svd2cpp_tests_" + name );
+    std::ofstream( path, std::ios::binary ) << text;
+    return path;
+}
+
+cxxopts::ParseResult parseOptions( std::vector< const char* > args )
+{
+    static cxxopts::Options options( "svd2cpp_tests" );
+    static const bool declared = [] {
+        options.add_options()( "p, parser", "", cxxopts::value< std::string >()->default_value( "dom" ) )(
+            "dedup", "" )( "overlay", "" )( "lean", "" )( "atomic", "", cxxopts::value< std::vector< std::string > >() )(
+            "only", "", cxxopts::value< std::vector< std::string > >() )(
+            "exclude", "", cxxopts::value< std::vector< std::string > >() )( "no-runtime", "" )(
+            "s, split", "", cxxopts::value< std::string >() )( "cache-dir", "", cxxopts::value< std::string >() );
+        return true;
+    }();
+    (void)declared;
+    args.insert( args.begin(), "svd2cpp_tests" );
+    return options.parse( static_cast< int >( args.size() ), args.data() );
+}
+
+DeviceModel parseModel( const std::string& input, const std::vector< const char* >& args, unsigned int jobs )
+{
+    const auto options = parseOptions( args );
+    std::unique_ptr< IParser > parser;
+    if( options["parser"].as< std::string >() == "stream" ) {
+        parser = std::make_unique< StreamParser >( input );
+    }
+    else {
+        parser = std::make_unique< XmlParser >( input, jobs );
+    }
+    REQUIRE( !parser->isError() );
+    parser->parseXml();
+    REQUIRE( !parser->isError() );
+    DeviceModel model = DeviceModel::fromPeripherals( parser->getDeviceInfo(), parser->getPeripherals() );
+    if( options.count( "dedup" ) ) {
+        Deduplicator::run( model, emitOptions( options ).atomic );
+    }
+    return model;
+}
+
+std::string emitHeader( const std::string& input, const std::vector< const char* >& args, unsigned int jobs )
+{
+    const auto options = parseOptions( args );
+    const DeviceModel model = parseModel( input, args, jobs );
+    FileBuilder builder( options, model );
+    builder.setupBuilders();
+    builder.build( jobs );
+    return builder.takeOutput();
+}
+
+std::filesystem::path writeGenerated( const std::string& header,
+    const std::string& input,
+    const std::vector< const char* >& args )
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "svd2cpp_tests_generated";
+    std::filesystem::create_directories( directory );
+    std::ofstream( directory / header, std::ios::binary ) << emitHeader( input, args );
+    REQUIRE( runtime::writeRegBase( directory ) );
+    return directory;
+}
+
+Compilation compile( const std::filesystem::path& source, const std::vector< std::string >& flags )
+{
+    const std::filesystem::path log = std::filesystem::path( source ).replace_extension( ".log" );
+    std::string command = "\"" SVD2CPP_TEST_CXX "\" -std=c++17 -I\"" + source.parent_path().string() + "\"";
+    for( auto& flag : flags ) {
+        command += " " + flag;
+    }
+    command += " \"" + source.string() + "\" >\"" + log.string() + "\" 2>&1";
+    Compilation compilation;
+    compilation.ok = std::system( command.c_str() ) == 0;
+    std::ostringstream output;
+    output << std::ifstream( log ).rdbuf();
+    compilation.output = output.str();
+    return compilation;
+}
+
+} // namespace fixtures
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DeviceModel.hpp"
+
+#include <cxxopts.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Shared by the tests: fixture files and the command line of svd2cpp
+namespace fixtures {
+
+// File in tests/data
+std::filesystem::path data( const std::string& name );
+
+// Writes text to a file in the temp directory and returns its path
+std::filesystem::path writeTemp( const std::string& name, const std::string& text );
+
+// args parsed with the options of svd2cpp that affect generation
+cxxopts::ParseResult parseOptions( std::vector< const char* > args );
+
+// Model of the input parsed with the backend of --parser in args
+DeviceModel parseModel( const std::string& input, const std::vector< const char* >& args = {}, unsigned int jobs = 1 );
+
+// Single header FileBuilder emits for the input
+std::string emitHeader( const std::string& input, const std::vector< const char* >& args = {}, unsigned int jobs = 1 );
+
+// Directory in the temp directory with the header emitted for the input,
+// named header, next to the RegBase.h of this svd2cpp
+std::filesystem::path writeGenerated( const std::string& header,
+    const std::string& input,
+    const std::vector< const char* >& args = {} );
+
+struct Compilation
+{
+    bool ok = false;
+    // Diagnostics of the compiler
+    std::string output;
+};
+
+// Runs the compiler svd2cpp_tests was built with on source, with the
+// source's directory as include path
+Compilation compile( const std::filesystem::path& source, const std::vector< std::string >& flags = {} );
+
+} // namespace fixtures
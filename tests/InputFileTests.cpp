@@ -0,0 +1,81 @@
+#include "Fixtures.hpp"
+#include "InputFile.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string contentOf( const std::string& name )
+{
+    std::ifstream file( fixtures::data( name ), std::ios::binary );
+    return { std::istreambuf_iterator< char >( file ), std::istreambuf_iterator< char >() };
+}
+
+const std::string pack = fixtures::data( "Test.Device_DFP.pack" ).string();
+
+} // namespace
+
+TEST_CASE( "Input names", "[input]" )
+{
+    CHECK( !input::isPacked( "a/STM32F40x.svd" ) );
+    CHECK( input::isPacked( "a/STM32F40x.svd.gz" ) );
+    CHECK( input::isPacked( "a/STM32F40x.svd.xz" ) );
+    CHECK( input::isPacked( pack + ":CMSIS/SVD/arrays.svd" ) );
+    CHECK( input::stemOf( "a/STM32F40x.svd" ) == "STM32F40x" );
+    CHECK( input::stemOf( "a/STM32F40x.svd.xz" ) == "STM32F40x" );
+    CHECK( input::stemOf( "DFP.pack:CMSIS/SVD/STM32F40x.svd" ) == "STM32F40x" );
+    CHECK( input::fileOf( pack + ":CMSIS/SVD/arrays.svd" ) == pack );
+    CHECK( input::isSvdFile( "a/b.svd.gz" ) );
+    CHECK( !input::isSvdFile( "a/b.pack" ) );
+}
+
+#ifdef SVD2CPP_HAVE_ZLIB
+TEST_CASE( "gzip files and zip members read back as their .svd", "[input]" )
+{
+    CHECK( input::read( fixtures::data( "usart_gpio.svd.gz" ).string() ) == contentOf( "usart_gpio.svd" ) );
+    //Deflated and stored members, by path or by file name alone
+    CHECK( input::read( pack + ":CMSIS/SVD/usart_gpio.svd" ) == contentOf( "usart_gpio.svd" ) );
+    CHECK( input::read( pack + ":arrays.svd" ) == contentOf( "arrays.svd" ) );
+    //The only .svd in the archive needs no member name
+    CHECK( input::read( fixtures::data( "single.zip" ).string() ) == contentOf( "derived.svd" ) );
+    CHECK_THROWS_AS( input::read( pack + ":CMSIS/SVD/missing.svd" ), std::runtime_error );
+    //Two .svd members, so one has to be named
+    CHECK_THROWS_AS( input::read( pack ), std::runtime_error );
+}
+
+TEST_CASE( "Packed inputs parse like the plain file", "[input][parser]" )
+{
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        const std::string expected =
+            fixtures::emitHeader( fixtures::data( "usart_gpio.svd" ).string(), { "--parser", parser } );
+        CHECK( fixtures::emitHeader( fixtures::data( "usart_gpio.svd.gz" ).string(), { "--parser", parser } )
+            == expected );
+        CHECK( fixtures::emitHeader( pack + ":usart_gpio.svd", { "--parser", parser } ) == expected );
+    }
+}
+#endif
+
+#ifdef SVD2CPP_HAVE_LZMA
+TEST_CASE( "xz files read back as their .svd", "[input]" )
+{
+    CHECK( input::read( fixtures::data( "widths.svd.xz" ).string() ) == contentOf( "widths.svd" ) );
+    for( auto parser : { "dom", "stream" } ) {
+        INFO( parser );
+        CHECK( fixtures::emitHeader( fixtures::data( "widths.svd.xz" ).string(), { "--parser", parser } )
+            == fixtures::emitHeader( fixtures::data( "widths.svd" ).string(), { "--parser", parser } ) );
+    }
+}
+#endif
+
+TEST_CASE( "Unreadable inputs throw", "[input]" )
+{
+    CHECK_THROWS_AS( input::read( fixtures::data( "missing.svd.gz" ).string() ), std::runtime_error );
+    const auto corrupt = fixtures::writeTemp( "corrupt.svd.gz", "not gzip at all" ).string();
+    CHECK_THROWS_AS( input::read( corrupt ), std::runtime_error );
+}
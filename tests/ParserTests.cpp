@@ -0,0 +1,49 @@
+#include "Fixtures.hpp"
+#include "StreamParser.hpp"
+#include "XmlParser.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+const char* const fixtureFiles[] = { "usart_gpio.svd", "widths.svd", "arrays.svd", "derived.svd" };
+
+} // namespace
+
+TEST_CASE( "DOM and stream parsers build the same model", "[parser]" )
+{
+    for( auto name : fixtureFiles ) {
+        INFO( name );
+        const std::string input = fixtures::data( name ).string();
+        XmlParser dom( input );
+        dom.parseXml();
+        StreamParser stream( input );
+        stream.parseXml();
+        REQUIRE( !dom.isError() );
+        REQUIRE( !stream.isError() );
+        CHECK( dom.getDeviceInfo() == stream.getDeviceInfo() );
+        CHECK( dom.getPeripherals() == stream.getPeripherals() );
+    }
+}
+
+TEST_CASE( "DOM and stream parsers emit the same header", "[parser]" )
+{
+    for( auto name : fixtureFiles ) {
+        INFO( name );
+        const std::string input = fixtures::data( name ).string();
+        CHECK( fixtures::emitHeader( input, { "--parser", "dom" } )
+            == fixtures::emitHeader( input, { "--parser", "stream" } ) );
+        CHECK( fixtures::emitHeader( input, { "--parser", "dom", "--dedup" } )
+            == fixtures::emitHeader( input, { "--parser", "stream", "--dedup" } ) );
+    }
+}
+
+TEST_CASE( "Malformed documents are errors in both parsers", "[parser]" )
+{
+    const auto input = fixtures::writeTemp( "broken.svd", "<device><name>X</name><peripherals>" ).string();
+    XmlParser dom( input );
+    StreamParser stream( input );
+    stream.parseXml();
+    CHECK( dom.isError() );
+    CHECK( stream.isError() );
+}
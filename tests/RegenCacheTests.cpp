@@ -0,0 +1,83 @@
+#include "Builders.hpp"
+#include "Fixtures.hpp"
+#include "Generator.hpp"
+#include "RegenCache.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string keyOf( const std::string& input, std::vector< const char* > args )
+{
+    args.insert( args.end(), { "--cache-dir", "cache" } );
+    const auto options = fixtures::parseOptions( args );
+    const auto key = RegenCache( options ).keyOf( input );
+    REQUIRE( key );
+    return *key;
+}
+
+std::string contentOf( const std::filesystem::path& path )
+{
+    std::ostringstream content;
+    content << std::ifstream( path, std::ios::binary ).rdbuf();
+    return content.str();
+}
+
+} // namespace
+
+TEST_CASE( "Cache keys change with the output, not with how it is made", "[cache]" )
+{
+    static_assert( outputFormatVersion > 0 );
+    const std::string input = fixtures::data( "usart_gpio.svd" ).string();
+    const std::string key = keyOf( input, {} );
+    CHECK( key.size() == 32 );
+    CHECK( keyOf( input, { "--parser", "stream" } ) == key );
+    CHECK( keyOf( input, { "--dedup" } ) != key );
+    CHECK( keyOf( input, { "--atomic", "none" } ) != key );
+    CHECK( keyOf( fixtures::data( "widths.svd" ).string(), {} ) != key );
+    CHECK( !RegenCache( fixtures::parseOptions( { "--cache-dir", "cache" } ) ).keyOf( "missing.svd" ) );
+}
+
+TEST_CASE( "A second run with the same input and options restores the output", "[cache]" )
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "svd2cpp_tests_cache";
+    std::filesystem::remove_all( directory );
+    std::filesystem::create_directories( directory );
+    const std::string input = fixtures::data( "usart_gpio.svd" ).string();
+    const std::string cacheDir = ( directory / "cache" ).string();
+    const std::filesystem::path output = directory / "out.hpp";
+    const auto run = [&]( std::vector< const char* > args ) {
+        args.insert( args.end(), { "--cache-dir", cacheDir.c_str() } );
+        const auto options = fixtures::parseOptions( args );
+        const GenerationResult result = Generator( options ).run( input, output.string() );
+        INFO( result.message );
+        REQUIRE( result.ok() );
+        return result;
+    };
+
+    CHECK( !run( {} ).cached );
+    const std::string header = contentOf( output );
+    CHECK( header.find( "namespace FEmbed" ) != std::string::npos );
+    //Back-dated, a rewrite would move it to now whatever the clock's resolution
+    const auto written = std::filesystem::last_write_time( output ) - std::chrono::hours( 1 );
+    std::filesystem::last_write_time( output, written );
+
+    CHECK( run( {} ).cached );
+    CHECK( contentOf( output ) == header );
+    CHECK( std::filesystem::last_write_time( output ) == written );
+
+    //Another option is another key, the output is generated again
+    CHECK( !run( { "--lean" } ).cached );
+    const std::string lean = contentOf( output );
+    CHECK( lean != header );
+    CHECK( run( { "--lean" } ).cached );
+    CHECK( contentOf( output ) == lean );
+    //The entry of the first options is still there
+    CHECK( run( {} ).cached );
+    CHECK( contentOf( output ) == header );
+}
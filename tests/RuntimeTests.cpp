@@ -0,0 +1,285 @@
+#include "Fixtures.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/wait.h>
+#endif
+
+namespace {
+
+// Header of runtime.svd generated with args, with its RegBase.h
+std::filesystem::path generated( const std::string& header = "Runtime.hpp",
+    const std::vector< const char* >& args = {} )
+{
+    return fixtures::writeGenerated( header, fixtures::data( "runtime.svd" ).string(), args );
+}
+
+// Source using the generated UART as Port
+fixtures::Compilation compileUse( const std::string& name, const std::string& statement )
+{
+    const std::filesystem::path source = generated() / ( name + ".cpp" );
+    std::ofstream( source ) << "#include \"Runtime.hpp\"\n"
+                               "using Port = FEmbed::Uart<>;\n"
+                               "using namespace FEmbed;\n"
+                               "void use()\n{\n    "
+                            << statement << ";\n}\n";
+    return fixtures::compile( source, { "-fsyntax-only" } );
+}
+
+#ifdef __linux__
+// Program that maps RAM where runtime.svd puts the UART, its alias offsets and
+// its bit-band alias words, so the generated accessors run on the host, and
+// runs body on it. EXPECT prints what fails.
+const char* const programBegin = R"(
+#include <sys/mman.h>
+#include <cstdio>
+#include <type_traits>
+#include <utility>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+using Port = FEmbed::Uart<>;
+using namespace FEmbed;
+
+static int failures = 0;
+#define EXPECT( condition ) \
+    if( !( condition ) ) { std::printf( "line %d: %s\n", __LINE__, #condition ); ++failures; }
+
+int main()
+{
+    for( auto [address, size] : { std::pair<uintptr_t, size_t>{ 0x40010000, 0x4000 }, { 0x42200000, 0x1000 } } ) {
+        void* const page = reinterpret_cast<void*>( address );
+        if( mmap( page, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0 ) != page ) {
+            return 77;
+        }
+    }
+)";
+
+struct Run
+{
+    // Exit code of the program, 77 if the UART's addresses were taken
+    int status = -1;
+    std::string output;
+};
+
+Run runOnRam( const std::string& name, const std::string& body, const std::vector< const char* >& args = {} )
+{
+    //Each program has its own header, the arguments may differ
+    const std::string header = name + ".hpp";
+    const std::filesystem::path source = generated( header, args ) / ( name + ".cpp" );
+    const std::filesystem::path program = std::filesystem::path( source ).replace_extension();
+    std::ofstream( source ) << "#include \"" << header << "\"" << programBegin << body << "    return failures;\n}\n";
+    const fixtures::Compilation compilation = fixtures::compile( source, { "-O1", "-o", program.string() } );
+    INFO( compilation.output );
+    REQUIRE( compilation.ok );
+    const std::filesystem::path log = std::filesystem::path( source ).replace_extension( ".out" );
+    Run run;
+    const int status = std::system( ( "\"" + program.string() + "\" >\"" + log.string() + "\" 2>&1" ).c_str() );
+    run.status = WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+    std::ostringstream output;
+    output << std::ifstream( log ).rdbuf();
+    run.output = output.str();
+    return run;
+}
+
+void checkRun( const Run& run )
+{
+    if( run.status == 77 ) {
+        WARN( "0x40010000 or 0x42200000 isn't free in this process, the runtime wasn't run" );
+        return;
+    }
+    INFO( run.output );
+    CHECK( run.status == 0 );
+}
+#endif
+
+} // namespace
+
+#ifdef __linux__
+TEST_CASE( "write and modify change only their fields with one store", "[runtime]" )
+{
+    checkRun( runOnRam( "writes", R"(
+    static_assert( Port::Cr::M::mask == 0x3000 );
+    static_assert( Port::Cr::M::shifted( 2 ) == 0x2000 );
+    static_assert( std::is_same_v<Port::Cr2::STOP::ValueType, uint16_t> );
+
+    Port::Cr::ref() = 0x5A5A5A5A;
+    write<Port::Cr::UE, Port::Cr::M>( 1, 2 );
+    EXPECT( Port::Cr::ref() == 0x5A5A6A5B );
+    //Bits beyond the field are dropped instead of reaching its neighbours
+    write<Port::Cr::M>( 0x7 );
+    EXPECT( Port::Cr::ref() == 0x5A5A7A5B );
+
+    Port::Cr::ref() = 0x5A5A5A5A;
+    modify<Value<Port::Cr::UE, 1>, Value<Port::Cr::M, 3>>();
+    EXPECT( Port::Cr::ref() == 0x5A5A7A5B );
+    modify<Value<Port::Cr::M, 0>>();
+    EXPECT( Port::Cr::ref() == 0x5A5A4A5B );
+
+    //A 16-bit register is stored with 16 bits, the next halfword keeps its value
+    volatile uint16_t& next = *reinterpret_cast<volatile uint16_t*>( 0x40010016 );
+    next = 0xBEEF;
+    Port::Cr2::ref() = 0x5A5A;
+    write<Port::Cr2::STOP>( 2 );
+    EXPECT( Port::Cr2::ref() == 0x6A5A );
+    EXPECT( next == 0xBEEF );
+
+    Port::Sr::ref() = 0x40;
+    EXPECT( read<Port::Sr::TC>() == 1 );
+    EXPECT( read<Port::Sr::RXNE>() == 0 );
+    EXPECT( Port::Cr::BUSY::read() == 0 );
+
+    Port::Dr::ref() = 0;
+    set<Port::Dr::DATA>( 0x1FF );
+    EXPECT( Port::Dr::ref() == 0x1FF );
+    reset<Port::Dr::DATA>();
+    EXPECT( Port::Dr::ref() == 0 );
+    set<Port::Dr::DATA>();
+    toggle<Port::Dr::DATA>();
+    EXPECT( Port::Dr::ref() == 0 );
+)" ) );
+}
+
+TEST_CASE( "init and assign store over the reset value without reading", "[runtime]" )
+{
+    //The registers hold garbage first, none of it may reach the stored value
+    checkRun( runOnRam( "resets", R"(
+    static_assert( Port::Cr::resetValue == 0xC00 );
+    Port::Cr::ref() = 0xFFFFFFFF;
+    init<Port::Cr::UE>( 1 );
+    EXPECT( Port::Cr::ref() == 0xC01 );
+    Port::Cr::ref() = 0xFFFFFFFF;
+    init<Port::Cr::UE, Port::Cr::M, Port::Cr::PCE>( 1, 2, 0 );
+    EXPECT( Port::Cr::ref() == 0x2801 );
+    Port::Cr::ref() = 0xFFFFFFFF;
+    assign<Value<Port::Cr::TXIE, 1>>();
+    EXPECT( Port::Cr::ref() == 0xC80 );
+
+    Port::Cr2::ref() = 0xFFFF;
+    init<Port::Cr2::STOP>( 3 );
+    EXPECT( Port::Cr2::ref() == 0x3001 );
+
+    //Write-only, the reset value is the only base there is
+    static_assert( Port::Cmd::resetValue == 0x80 );
+    Port::Cmd::ref() = 0xFFFFFFFF;
+    init<Port::Cmd::START>( 1 );
+    EXPECT( Port::Cmd::ref() == 0x81 );
+    Port::Cmd::ref() = 0xFFFFFFFF;
+    assign<Value<Port::Cmd::MODE, 2>>();
+    EXPECT( Port::Cmd::ref() == 0x20 );
+
+    //Without a resetValue anywhere the reset is taken as 0, so the fields
+    //that aren't given are written as 0
+    static_assert( Port::Trig::resetValue == 0 );
+    Port::Trig::ref() = 0xFFFFFFFF;
+    init<Port::Trig::GO, Port::Trig::CH>( 1, 5 );
+    EXPECT( Port::Trig::ref() == 0x501 );
+    Port::Trig::ref() = 0xFFFFFFFF;
+    assign<Value<Port::Trig::GO, 1>>();
+    EXPECT( Port::Trig::ref() == 0x1 );
+)" ) );
+}
+TEST_CASE( "set and reset store once to the alias the atomic policy names", "[runtime][atomic]" )
+{
+    //CR is at 0x40010000, its bit b has the bit-band word 0x42200000 + 4 * b
+    checkRun( runOnRam( "bitband", R"(
+    static_assert( isAtomic<Port::Cr::UE, AtomicOp::Set> );
+    static_assert( !isAtomic<Port::Cr::M, AtomicOp::Set> );
+    static_assert( !isAtomic<Port::Cr::UE, AtomicOp::Toggle> );
+    volatile uint32_t* const words = reinterpret_cast<volatile uint32_t*>( 0x42200000 );
+
+    Port::Cr::ref() = 0x5A5A5A5A;
+    set<Port::Cr::UE>();
+    EXPECT( words[0] == 1 );
+    reset<Port::Cr::TXIE>();
+    EXPECT( words[7] == 0 );
+    words[7] = 0xFFFFFFFF;
+    reset<Port::Cr::TXIE>();
+    EXPECT( words[7] == 0 );
+    //The register itself is only reached through the alias
+    EXPECT( Port::Cr::ref() == 0x5A5A5A5A );
+
+    //Toggle and fields wider than a bit read, modify and write
+    toggle<Port::Cr::UE>();
+    EXPECT( Port::Cr::ref() == 0x5A5A5A5B );
+    set<Port::Cr::M>();
+    EXPECT( Port::Cr::ref() == 0x5A5A7A5B );
+    EXPECT( words[0] == 1 );
+)", { "--atomic", "bitband" } ) );
+
+    //Set, clear and toggle registers 0x1000, 0x2000 and 0x3000 after the register
+    checkRun( runOnRam( "aliases", R"(
+    static_assert( isAtomic<Port::Cr::M, AtomicOp::Toggle> );
+    volatile uint32_t* const cr = &Port::Cr::ref();
+    volatile uint16_t* const cr2 = &Port::Cr2::ref();
+
+    *cr = 0x5A5A5A5A;
+    set<Port::Cr::M>();
+    EXPECT( cr[0x400] == 0x3000 );
+    reset<Port::Cr::UE>();
+    EXPECT( cr[0x800] == 0x1 );
+    toggle<Port::Cr::TXIE>();
+    EXPECT( cr[0xC00] == 0x80 );
+    EXPECT( *cr == 0x5A5A5A5A );
+
+    //The alias is stored with the register's width
+    cr2[0x1001] = 0xBEEF;
+    reset<Port::Cr2::STOP>();
+    EXPECT( cr2[0x1000] == 0x3000 );
+    EXPECT( cr2[0x1001] == 0xBEEF );
+)", { "--atomic", "UART=alias:0x1000:0x2000:0x3000" } ) );
+
+    //Without --atomic every store reads, modifies and writes the register
+    checkRun( runOnRam( "noatomic", R"(
+    static_assert( !isAtomic<Port::Cr::UE, AtomicOp::Set> );
+    Port::Cr::ref() = 0x5A5A5A5A;
+    set<Port::Cr::UE>();
+    EXPECT( Port::Cr::ref() == 0x5A5A5A5B );
+    EXPECT( *reinterpret_cast<volatile uint32_t*>( 0x42200000 ) == 0 );
+)" ) );
+}
+#endif
+
+TEST_CASE( "Accesses the access forbids and mixed registers don't compile", "[runtime]" )
+{
+    const fixtures::Compilation valid = compileUse( "valid", "write<Port::Cr::UE, Port::Cr::M>( 1, 2 )" );
+    INFO( valid.output );
+    REQUIRE( valid.ok );
+
+    const struct
+    {
+        const char* name;
+        const char* statement;
+        const char* error;
+    } misuses[] = {
+        { "readonlyregister", "write<Port::Sr::TC>( 1 )", "Field is read-only" },
+        { "readonlyfield", "write<Port::Cr::UE, Port::Cr::BUSY>( 1, 1 )", "Field is read-only" },
+        { "readonlymodify", "modify<Value<Port::Cr::BUSY, 1>>()", "Field is read-only" },
+        { "readonlyraw", "Port::Sr::write( 0 )", "Register is read-only" },
+        { "mixedwrite", "write<Port::Cr::UE, Port::Cr2::STOP>( 1, 1 )", "All fields must belong to the same register" },
+        { "mixedmodify", "modify<Value<Port::Cr::UE, 1>, Value<Port::Dr::DATA, 1>>()",
+            "All fields must belong to the same register" },
+        { "valuewidth", "modify<Value<Port::Cr::M, 4>>()", "Value doesn't fit the field" },
+        //A write-only register can't be read back, it is only written whole
+        { "writeonlywrite", "write<Port::Trig::GO>( 1 )", "Register is write-only, use init()" },
+        { "writeonlymodify", "modify<Value<Port::Cmd::START, 1>>()", "Register is write-only, use assign()" },
+        { "writeonlyread", "read<Port::Trig::CH>()", "Field is write-only" },
+        { "readonlyinit", "init<Port::Sr::TC>( 1 )", "Field is read-only" },
+    };
+    for( auto& misuse : misuses ) {
+        INFO( misuse.statement );
+        const fixtures::Compilation compilation = compileUse( misuse.name, misuse.statement );
+        INFO( compilation.output );
+        CHECK( !compilation.ok );
+        CHECK( compilation.output.find( misuse.error ) != std::string::npos );
+    }
+}
@@ -0,0 +1,104 @@
+#include "Fixtures.hpp"
+#include "SplitFileBuilder.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Files each file includes, by file name
+std::map< std::string, std::vector< std::string > > includesOf( const std::vector< OutputFile >& files )
+{
+    std::map< std::string, std::vector< std::string > > includes;
+    for( auto& file : files ) {
+        auto& names = includes[file.name];
+        const std::string directive = "#include \"";
+        for( auto at = file.content.find( directive ); at != std::string::npos;
+             at = file.content.find( directive, at + 1 ) ) {
+            const auto start = at + directive.size();
+            names.push_back( file.content.substr( start, file.content.find( '"', start ) - start ) );
+        }
+    }
+    return includes;
+}
+
+bool hasCycle( const std::map< std::string, std::vector< std::string > >& includes )
+{
+    std::set< std::string > done, active;
+    std::function< bool( const std::string& ) > visit = [&]( const std::string& name ) {
+        if( active.count( name ) ) {
+            return true;
+        }
+        if( !done.insert( name ).second ) {
+            return false;
+        }
+        active.insert( name );
+        const auto it = includes.find( name );
+        if( it != includes.end() ) {
+            for( auto& include : it->second ) {
+                if( visit( include ) ) {
+                    return true;
+                }
+            }
+        }
+        active.erase( name );
+        return false;
+    };
+    for( auto& [name, names] : includes ) {
+        if( visit( name ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const OutputFile& fileNamed( const std::vector< OutputFile >& files, const std::string& name )
+{
+    for( auto& file : files ) {
+        if( file.name == name ) {
+            return file;
+        }
+    }
+    FAIL( "no " << name );
+    return files.front();
+}
+
+} // namespace
+
+TEST_CASE( "Split headers never include each other in a cycle", "[split]" )
+{
+    const std::string input = fixtures::data( "crossgroups.svd" ).string();
+    for( auto args : { std::vector< const char* >{}, { "--dedup" } } ) {
+        const DeviceModel model = fixtures::parseModel( input, args );
+        for( auto mode : { ESplitMode::Peripheral, ESplitMode::Group } ) {
+            SplitFileBuilder builder( model, mode );
+            builder.build();
+            const auto files = builder.takeFiles();
+            CHECK( !hasCycle( includesOf( files ) ) );
+        }
+    }
+}
+
+TEST_CASE( "Groups whose aliases refer to each other share one header", "[split]" )
+{
+    const DeviceModel model = fixtures::parseModel( fixtures::data( "crossgroups.svd" ).string() );
+    SplitFileBuilder builder( model, ESplitMode::Group );
+    builder.build();
+    const auto files = builder.takeFiles();
+    //USART and UART alias each other's classes, LPUART only refers to USART
+    const auto& usart = fileNamed( files, "USART.hpp" );
+    CHECK( usart.content.find( "class Usart1" ) != std::string::npos );
+    CHECK( usart.content.find( "class Uart5" ) != std::string::npos );
+    CHECK( usart.content.find( "using Uart4" ) != std::string::npos );
+    CHECK( usart.content.find( "using Usart2" ) != std::string::npos );
+    CHECK( usart.content.find( "class Usart1" ) < usart.content.find( "using Uart4" ) );
+    CHECK( usart.content.find( "class Uart5" ) < usart.content.find( "using Usart2" ) );
+    CHECK( fileNamed( files, "UART.hpp" ).content == "#pragma once\n#include \"USART.hpp\"" );
+    CHECK( includesOf( files )["LPUART.hpp"] == std::vector< std::string >{ "common.hpp", "USART.hpp" } );
+    CHECK( includesOf( files )["CROSS.hpp"] == std::vector< std::string >{ "USART.hpp", "LPUART.hpp" } );
+}
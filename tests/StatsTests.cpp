@@ -0,0 +1,29 @@
+#include "Stats.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <new>
+
+TEST_CASE( "Allocations are counted only while counting is on", "[stats]" )
+{
+    countAllocations( false );
+    std::uint64_t before = allocationCount();
+    auto ignored = std::make_unique< int >( 1 );
+    CHECK( allocationCount() == before );
+
+    countAllocations( true );
+    before = allocationCount();
+    auto single = std::make_unique< int >( 1 );
+    auto array = std::make_unique< int[] >( 4 );
+    auto* nothrow = new( std::nothrow ) int( 1 );
+    struct alignas( 64 ) Line
+    {
+        char bytes[64];
+    };
+    auto aligned = std::make_unique< Line >();
+    countAllocations( false );
+    CHECK( allocationCount() - before == 4 );
+    CHECK( reinterpret_cast< std::uintptr_t >( aligned.get() ) % 64 == 0 );
+    delete nothrow;
+}
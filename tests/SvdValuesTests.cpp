@@ -0,0 +1,114 @@
+#include "Fixtures.hpp"
+#include "Stats.hpp"
+#include "StreamParser.hpp"
+#include "SvdValues.hpp"
+#include "XmlParser.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+
+#include <memory>
+#include <string>
+
+namespace {
+
+std::uint64_t scaled( std::string_view text )
+{
+    std::uint64_t value = 0;
+    REQUIRE( svd::parseScaledInteger( text, value ) );
+    return value;
+}
+
+bool malformed( std::string_view text )
+{
+    std::uint64_t value = 0;
+    return !svd::parseScaledInteger( text, value );
+}
+
+// Device with one register of fieldCount one-bit fields
+std::string deviceWithFields( unsigned int fieldCount )
+{
+    std::string fields;
+    for( unsigned int i = 0; i < fieldCount; ++i ) {
+        fields += fmt::format(
+            "<field><name>F{}</name><bitOffset>{}</bitOffset><bitWidth>1</bitWidth><access>read-only</access></field>",
+            i, i % 32 );
+    }
+    return fmt::format( R"(<?xml version="1.0" encoding="utf-8"?>
+<device schemaVersion="1.1"><name>ALLOC</name><version>1.0</version><size>32</size>
+<peripherals><peripheral><name>P</name><baseAddress>0x40000000</baseAddress><registers>
+<register><name>R</name><addressOffset>0x0</addressOffset><resetValue>0x0</resetValue><fields>{}</fields></register>
+</registers></peripheral></peripherals></device>
+)",
+        fields );
+}
+
+template< typename Parser >
+std::uint64_t parseAllocations( unsigned int fieldCount )
+{
+    const auto input = fixtures::writeTemp( fmt::format( "alloc{}.svd", fieldCount ), deviceWithFields( fieldCount ) );
+    Parser parser( input.string() );
+    REQUIRE( !parser.isError() );
+    countAllocations( true );
+    parser.parseXml();
+    countAllocations( false );
+    REQUIRE( parser.getPeripherals().at( 0 ).registers->at( 0 ).fields.size() == fieldCount );
+    return parser.getPhases().parse.allocations;
+}
+
+} // namespace
+
+TEST_CASE( "Scaled integers in every SVD form", "[values]" )
+{
+    CHECK( scaled( "42" ) == 42 );
+    CHECK( scaled( "+42" ) == 42 );
+    CHECK( scaled( "0x1F" ) == 0x1F );
+    CHECK( scaled( "0X1f" ) == 0x1F );
+    CHECK( scaled( "#1010" ) == 0b1010 );
+    CHECK( scaled( "0b1010" ) == 0b1010 );
+    CHECK( scaled( "4k" ) == 4 * 1024 );
+    CHECK( scaled( "2M" ) == 2 * 1024 * 1024 );
+    CHECK( scaled( "0xFFFFFFFFFFFFFFFF" ) == UINT64_MAX );
+    CHECK( malformed( "" ) );
+    CHECK( malformed( "0x" ) );
+    CHECK( malformed( "12z" ) );
+    CHECK( malformed( "-1" ) );
+    CHECK( malformed( "0x10000000000000000" ) );
+    CHECK( malformed( "#102" ) );
+}
+
+TEST_CASE( "Unsigned values report malformed text as 0", "[values]" )
+{
+    CHECK( svd::parseUnsigned( "0x40" ) == 0x40 );
+    CHECK( svd::parseUnsigned( "nope" ) == 0 );
+}
+
+TEST_CASE( "Access enumeration", "[values]" )
+{
+    EAccess access = EAccess::Read_Write;
+    CHECK( svd::parseAccess( "read-only", access ) );
+    CHECK( access == EAccess::Read_Only );
+    CHECK( svd::parseAccess( "write-only", access ) );
+    CHECK( access == EAccess::Write_Only );
+    CHECK( svd::parseAccess( "read-write", access ) );
+    CHECK( access == EAccess::Read_Write );
+    CHECK( svd::parseAccess( "writeOnce", access ) );
+    CHECK( access == EAccess::Write_Only );
+    CHECK( svd::parseAccess( " read-writeOnce ", access ) );
+    CHECK( access == EAccess::Read_Write );
+    CHECK( !svd::parseAccess( "read", access ) );
+    CHECK( access == EAccess::Read_Write );
+}
+
+TEST_CASE( "Parsing a field allocates nothing but its share of the field vector", "[values][stats]" )
+{
+    //Short names stay in the small string buffer, so extra fields only cost
+    //the vector's growth
+    const unsigned int extraFields = 256;
+    const std::uint64_t dom = parseAllocations< XmlParser >( 16 + extraFields ) - parseAllocations< XmlParser >( 16 );
+    const std::uint64_t stream
+        = parseAllocations< StreamParser >( 16 + extraFields ) - parseAllocations< StreamParser >( 16 );
+    UNSCOPED_INFO( "dom " << dom << " / stream " << stream << " allocations for " << extraFields << " fields" );
+    CHECK( dom <= 8 );
+    CHECK( stream <= 8 );
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+# Compares the code generated for one sequence of register accesses with and
+# without --overlay. Both headers come from the same small device, the probe
+# touches four registers of one peripheral and the instructions of the probe
+# function are counted in the -S output.
+#
+# usage: tools/overlay_codegen_check.sh [path/to/svd2cpp]
+# The difference only shows on targets that build addresses from literal
+# pools, so arm-none-eabi-g++ for Cortex-M4 is required. CXX and CXXFLAGS
+# select another cross compiler. Fails if the overlay takes more instructions.
+set -euo pipefail
+
+SVD2CPP=${1:-build/Release/src/svd2cpp}
+if [ -z "${CXX:-}" ]; then
+    if ! command -v arm-none-eabi-g++ >/dev/null; then
+        echo "arm-none-eabi-g++ not found, set CXX to a cross compiler for a Cortex-M target" >&2
+        exit 2
+    fi
+    CXX=arm-none-eabi-g++
+    CXXFLAGS=${CXXFLAGS:--mcpu=cortex-m4 -mthumb}
+fi
+CXXFLAGS=${CXXFLAGS:-}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+cat >"$work/check.svd" <<'EOF'
+<?xml version="1.0" encoding="utf-8"?>
+<device>
+  <name>CHECK</name>
+  <size>32</size>
+  <peripherals>
+    <peripheral>
+      <name>UART</name>
+      <baseAddress>0x40011000</baseAddress>
+      <addressBlock><offset>0</offset><size>0x400</size><usage>registers</usage></addressBlock>
+      <registers>
+        <register><name>SR</name><addressOffset>0x0</addressOffset>
+          <fields><field><name>TXE</name><bitOffset>7</bitOffset><bitWidth>1</bitWidth></field></fields></register>
+        <register><name>DR</name><addressOffset>0x4</addressOffset>
+          <fields><field><name>DR</name><bitOffset>0</bitOffset><bitWidth>9</bitWidth></field></fields></register>
+        <register><name>BRR</name><addressOffset>0x8</addressOffset>
+          <fields><field><name>DIV</name><bitOffset>0</bitOffset><bitWidth>16</bitWidth></field></fields></register>
+        <register><name>CR1</name><addressOffset>0xC</addressOffset>
+          <fields>
+            <field><name>UE</name><bitOffset>13</bitOffset><bitWidth>1</bitWidth></field>
+            <field><name>TE</name><bitOffset>3</bitOffset><bitWidth>1</bitWidth></field>
+          </fields></register>
+      </registers>
+    </peripheral>
+  </peripherals>
+</device>
+EOF
+
+cat >"$work/probe.cpp" <<'EOF'
+#include "check.hpp"
+using Uart = FEmbed::Uart<>;
+void probe( unsigned int divider, unsigned int data )
+{
+    FEmbed::init<Uart::Brr::DIV>( divider );
+    FEmbed::write<Uart::Cr1::UE, Uart::Cr1::TE>( 1, 1 );
+    while( !FEmbed::read<Uart::Sr::TXE>() ) {
+    }
+    FEmbed::init<Uart::Dr::DR>( data );
+}
+EOF
+
+count() {
+    # instructions between the probe's label and the end of the function
+    awk '/^_?_Z5probejj:/ { inside = 1; next }
+         inside && /^\t\.size|^\t\.cfi_endproc|^_?_Z/ { exit }
+         inside && /^\t[a-z]/ && !/^\t\./ { n++ }
+         END { print n + 0 }' "$1"
+}
+
+for mode in absolute overlay; do
+    mkdir -p "$work/$mode"
+    flags=""
+    [ "$mode" = overlay ] && flags="--overlay"
+    "$SVD2CPP" -i "$work/check.svd" -o "$work/$mode/check.hpp" $flags >/dev/null
+    cp "$work/probe.cpp" "$work/$mode/"
+    # shellcheck disable=SC2086
+    "$CXX" -std=c++17 -O2 $CXXFLAGS -S -o "$work/$mode/probe.s" "$work/$mode/probe.cpp"
+done
+
+absolute=$(count "$work/absolute/probe.s")
+overlay=$(count "$work/overlay/probe.s")
+echo "compiler: $CXX $CXXFLAGS"
+echo "absolute: $absolute instructions"
+echo "overlay:  $overlay instructions"
+if [ -n "${VERBOSE:-}" ]; then
+    diff -u "$work/absolute/probe.s" "$work/overlay/probe.s" || true
+fi
+if [ "$overlay" -gt "$absolute" ]; then
+    echo "--overlay takes more instructions than absolute addresses" >&2
+    exit 1
+fi